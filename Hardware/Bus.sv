@@ -100,6 +100,75 @@ module BusMux (
     endgenerate
 endmodule
 
+module BusArbiter #(parameter MASTER_COUNT = 1) (
+    input clk,
+    input rst,
+    // Front facing
+    bus_master.back masters[MASTER_COUNT],
+    // To the bus controller
+    bus_master.front bus
+);
+    // Flattened master signals, since interface arrays 
+    // can't be indexed by a variable
+    logic        start      [MASTER_COUNT];
+    logic        write      [MASTER_COUNT];
+    logic [31:0] address    [MASTER_COUNT];
+    logic [31:0] write_data [MASTER_COUNT];
+
+    // The master which had the bus last cycle, and the one which has it now
+    logic [31:0] owner;
+    logic [31:0] grant;
+
+    // Round robin: the owner keeps the bus until its transfer completes, 
+    // then the next master after it which is requesting gets it
+    always_comb begin
+        grant = owner;
+        if (!start[owner]) begin
+            for (int i = MASTER_COUNT; i > 0; i--) begin
+                automatic int m = (owner + i) % MASTER_COUNT;
+                if (start[m])
+                    grant = m;
+            end
+        end
+    end
+
+    generate
+        for (genvar m = 0; m < MASTER_COUNT; m++) begin
+            assign start[m]      = masters[m].start;
+            assign write[m]      = masters[m].write;
+            assign address[m]    = masters[m].address;
+            assign write_data[m] = masters[m].write_data;
+
+            assign masters[m].read_data = bus.read_data;
+            assign masters[m].response  = bus.response;
+            assign masters[m].available = !start[grant] || grant == m;
+            // Only the master whose transfer was on the bus sees the reply
+            assign masters[m].ready 
+                = start[m] 
+                ? bus.ready && grant == m && owner == m
+                : bus.ready;
+        end
+    endgenerate
+
+    // When the bus changes hands an idle cycle is put on it, so devices
+    // see the next master's transfer as a new one
+    assign bus.start      = start[grant] && grant == owner;
+    assign bus.address    = address[grant];
+    assign bus.write      = write[grant];
+    assign bus.write_data = write_data[grant];
+
+    always_ff @(posedge clk or negedge rst) begin
+        if (!rst) begin
+            `LOG(("Resetting bus arbiter"));
+            owner <= 0;
+        end else begin
+            if (grant != owner)
+                `LOG(("Bus granted to master %0d", grant));
+            owner <= grant;
+        end
+    end
+endmodule
+
 module BusController (
     input clk,
     input rst,
@@ -145,28 +214,32 @@ module BusController (
         end
     endgenerate
 
-    always_ff @(posedge clk or negedge rst) begin
-        if (!rst) begin
-            `LOG(("Resetting bus controller"));
-            sel <= 1;
-        end else begin
-            // Address Decoding
-            for (int i = 0; i < AHB_DEVICE_COUNT; i++) begin
-                automatic int from 
-                    = (i == 0)              
-                    ? 32'b0
-                    : 32'(AHB_ADDR_MAP[i-1]);
-                automatic int to   
-                    = (i == AHB_DEVICE_COUNT-1) 
-                    ? 32'hFFFFFFFF 
-                    : 32'(AHB_ADDR_MAP[i]) - 1;
-                if (bus.address >= from && bus.address <= to) begin
-                    `LOG(("Multiplexed address 0x%h to device %0d", bus.address, i));
-                    sel <= 1 << i;
-                    mux <= i;
-                end
+    // Address decoding, from the address on the bus now rather than the
+    // one seen at the last edge, as a master such as the DMA unit can move
+    // from one device to another between back to back transfers
+    always_comb begin
+        sel = 0;
+        mux = 0;
+        for (int i = 0; i < AHB_DEVICE_COUNT; i++) begin
+            automatic int from 
+                = (i == 0)              
+                ? 32'b0
+                : 32'(AHB_ADDR_MAP[i-1]);
+            automatic int to   
+                = (i == AHB_DEVICE_COUNT-1) 
+                ? 32'hFFFFFFFF 
+                : 32'(AHB_ADDR_MAP[i]) - 1;
+            if (bus.address >= from && bus.address <= to) begin
+                sel = 1 << i;
+                mux = i;
             end
         end
     end
+
+    always_ff @(posedge clk) begin
+        if (rst && trans != BUS_TRANSFER_IDLE) begin
+            `LOG(("Multiplexed address 0x%h to device %0d", bus.address, mux));
+        end
+    end
 endmodule
 
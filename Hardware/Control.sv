@@ -8,6 +8,7 @@ typedef struct {
     logic [31:0] immediate;
     logic [3:0] destination;
     logic [31:0] pc;
+    logic [31:0] instruction; // Undecoded, for the simulation to observe
 } decoded;
 
 typedef struct {
@@ -74,6 +75,16 @@ module ControlUnit (
         .control_unit(cu_to_execute)
     );
 
+    // Set when the whole pipeline is blocked on an instruction fetch, so 
+    // clocking the core does nothing until the bus device becomes ready
+    logic quiescent;
+    assign quiescent
+        =  fetch.waiting
+        && fetch_to_decode.idle
+        && decode_to_execute.idle
+        && !execute_to_reg.do_write
+        && !cu_to_execute.set_pc;
+
     always_comb begin 
         flush = cu_to_execute.set_pc;
         cu_to_execute.flush = flush;
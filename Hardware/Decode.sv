@@ -222,6 +222,7 @@ module DecodeUnit (
         can_decode     = !error && fetcher.valid && executor.ready;
 
         executor.data.pc          = fetcher.data.address;
+        executor.data.instruction = fetcher.data.instruction;
         executor.data.destination = split.rd[3:0];
         executor.data.immediate   = split.immediate;
         executor.data.opcode      = split.opcode;
@@ -0,0 +1,110 @@
+`include "Common.svh"
+
+interface dma_control;
+    logic start;
+    logic acknowledge;
+    logic [31:0] source;
+    logic [31:0] destination;
+    logic [31:0] length;
+    logic busy;
+    logic done;
+
+    modport back (
+        input  start, acknowledge, source, destination, length,
+        output busy, done
+    );
+    modport front (
+        output start, acknowledge, source, destination, length,
+        input  busy, done
+    );
+endinterface
+
+module DmaUnit (
+    input clock,
+    input nreset,
+    dma_control.back control,
+    bus_master.front bus
+);
+    enum {
+        IDLE,
+        READING,
+        WRITING
+    } state;
+
+    logic [31:0] source;
+    logic [31:0] destination;
+    logic [31:0] remaining;
+    logic [31:0] data;
+
+    assign control.busy = state != IDLE;
+
+    always_ff @(posedge clock or negedge nreset) begin
+        if (!nreset) begin
+            `LOG(("Resetting DMA"));
+            state <= IDLE;
+            bus.start <= 0;
+            control.done <= 0;
+        end else begin
+            case (state)
+            IDLE: begin
+                if (control.acknowledge) begin
+                    control.done <= 0;
+                end
+                if (control.start) begin
+                    `LOG((
+                        "Starting copy of %0d bytes from 0x%h to 0x%h",
+                        control.length,
+                        control.source,
+                        control.destination
+                    ));
+                    source <= control.source;
+                    destination <= control.destination;
+                    remaining <= control.length >> 2;
+                    control.done <= 0;
+                    state <= READING;
+                end
+            end
+            READING: begin
+                if (remaining == 0) begin
+                    `LOG(("Copy finished"));
+                    control.done <= 1;
+                    state <= IDLE;
+                end else if (!bus.start) begin
+                    if (bus.available) begin
+                        `LOG(("Reading from 0x%h", source));
+                        bus.address <= source;
+                        bus.write <= 0;
+                        bus.start <= 1;
+                    end else begin
+                        `LOG(("Waiting for the bus to read"));
+                    end
+                end else if (bus.ready) begin
+                    `LOG(("Read 0x%h", bus.read_data));
+                    bus.start <= 0;
+                    data <= bus.read_data;
+                    source <= source + 4;
+                    state <= WRITING;
+                end
+            end
+            WRITING: begin
+                if (!bus.start) begin
+                    if (bus.available) begin
+                        `LOG(("Writing 0x%h to 0x%h", data, destination));
+                        bus.address <= destination;
+                        bus.write_data <= data;
+                        bus.write <= 1;
+                        bus.start <= 1;
+                    end else begin
+                        `LOG(("Waiting for the bus to write"));
+                    end
+                end else if (bus.ready) begin
+                    bus.start <= 0;
+                    destination <= destination + 4;
+                    remaining <= remaining - 1;
+                    state <= READING;
+                end
+            end
+            endcase
+        end
+    end
+endmodule
@@ -21,9 +21,18 @@ module FetchUnit (
         WAITING
     } state;
 
+    // A fetch has been issued and nothing changes until the bus replies
+    logic waiting;
+    assign waiting = state == WAITING && !control_unit.increment;
+
+    // Cycles spent waiting for the bus, either to be free or for a reply
+    logic [63:0] stall_count;
+
     always_ff @(posedge clock or negedge nreset) begin
         if (!nreset || control_unit.flush) begin
             `LOG(("Resetting fetch"));
+            if (!nreset)
+                stall_count <= 0;
             state <= IDLE;
             control_unit.increment <= 0;
             decoder.valid <= 0;
@@ -44,8 +53,10 @@ module FetchUnit (
                     state <= WAITING;
                 end else if (!bus.available) begin
                     `LOG(("...Bus already has a transaction in progress"));
+                    stall_count <= stall_count + 1;
                 end else if (!bus.ready) begin
                     `LOG(("...Device on bus is busy"));
+                    stall_count <= stall_count + 1;
                 end else begin
                     `LOG(("...Decoder is busy"));
                 end
@@ -67,6 +78,7 @@ module FetchUnit (
                     end
                 end else begin
                     `LOG(("...No reply yet"));
+                    stall_count <= stall_count + 1;
                 end 
             end
             endcase
@@ -18,6 +18,7 @@ task log_inner(input string file, input string str);
         "Hardware/Execute.sv"  : begin code = "[35m"; name = "executor";      end
         "Hardware/Decode.sv"   : begin code = "[36m"; name = "decoder";       end
         "Hardware/Register.sv" : begin code = "[91m"; name = "register file"; end
+        "Hardware/Dma.sv"      : begin code = "[92m"; name = "dma";           end
         default                : begin code = "[0m";  name = "?";             end
         endcase
 
@@ -66,6 +66,13 @@ module RegisterFile (
         end
     end
 
+    // Lets the simulation set registers between cycles
+    task write_register(input [3:0] i, input [31:0] value);
+        /* verilator public */
+        if (i > 0)
+            x[i] = value;
+    endtask
+
     function [31:0] read_register(input [3:0] loc);
     begin
         if (loc == 0) 
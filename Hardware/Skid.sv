@@ -23,6 +23,14 @@ module SkidBuffer #(type T, string NAME) (
 
     T buffer;
 
+    // Nothing is buffered or moving through, so the state can't change
+    // until upstream produces something
+    logic idle;
+    assign idle = state == ACTIVE && !up.valid && !down.valid;
+
+    logic stalled;
+    assign stalled = state == STALLED;
+
     always_ff @(negedge clock or negedge nreset) begin
         if (!nreset || flush) begin
             `LOG(("(%s) Resetting skid buffer", NAME));
@@ -5,10 +5,18 @@
 //       than decoder
 // FIXME: JALR requires that funct3 is zero'd
 
+// Number of cores sharing the bus, set at build time
+`ifndef HART_COUNT
+`define HART_COUNT 1
+`endif
+
 // Global parameters
-parameter AHB_DEVICE_COUNT /* verilator public */ = 2;
+parameter HART_COUNT /* verilator public */ = `HART_COUNT;
+parameter AHB_DEVICE_COUNT /* verilator public */ = 4;
 parameter [31:0] AHB_ADDR_MAP[AHB_DEVICE_COUNT-1] /* verilator public */ = '{
-    2048
+    2048, // Memory
+    2304, // Console
+    2560  // DMA
 };
 
 module Top (
@@ -26,12 +34,22 @@ module Top (
     output wire                ext_sel       [AHB_DEVICE_COUNT],
     input logic [31:0]         ext_rdata     [AHB_DEVICE_COUNT],
     input logic                ext_ready_slv [AHB_DEVICE_COUNT],
-    input transfer_response    ext_resp      [AHB_DEVICE_COUNT]
+    input transfer_response    ext_resp      [AHB_DEVICE_COUNT],
+    input logic                dma_start,
+    input logic                dma_acknowledge,
+    input logic [31:0]         dma_source,
+    input logic [31:0]         dma_destination,
+    input logic [31:0]         dma_length,
+    output wire                dma_busy,
+    output wire                dma_irq
 );
     logic [AHB_DEVICE_COUNT-1:0] sel;
     bus_slv_in conn_in();
     bus_slv_out conn_out[AHB_DEVICE_COUNT]();
-    bus_master master();
+    // One master per hart, then the DMA
+    bus_master masters[HART_COUNT+1]();
+    bus_master arbitrated();
+    dma_control dma_ctl();
 
     // External bus common signals
     assign ext_write     = conn_in.write;
@@ -52,21 +70,98 @@ module Top (
         assign conn_out[i].resp  = ext_resp[i]; 
     end
 
-    ControlUnit cu (
+    // DMA registers are held by the simulated device
+    assign dma_ctl.start       = dma_start;
+    assign dma_ctl.acknowledge = dma_acknowledge;
+    assign dma_ctl.source      = dma_source;
+    assign dma_ctl.destination = dma_destination;
+    assign dma_ctl.length      = dma_length;
+    assign dma_busy            = dma_ctl.busy;
+    assign dma_irq             = dma_ctl.done;
+
+    for (genvar h = 0; h < HART_COUNT; h++) begin : harts
+        ControlUnit cu (
+            .clock(clock),
+            .nreset(nreset),
+            .bus(masters[h])
+        );
+
+        // A hart can only be named with a constant index, so a register
+        // write is handed along the harts until it reaches the right one
+        if (h == HART_COUNT - 1) begin : dispatch
+            task write_register(
+                input [31:0] hart, input [3:0] i, input [31:0] value
+            );
+                cu.register_file.write_register(i, value);
+            endtask
+        end else begin : dispatch
+            task write_register(
+                input [31:0] hart, input [3:0] i, input [31:0] value
+            );
+                if (hart == h)
+                    cu.register_file.write_register(i, value);
+                else
+                    harts[h + 1].dispatch.write_register(hart, i, value);
+            endtask
+        end
+    end
+
+    DmaUnit dma (
         .clock(clock),
         .nreset(nreset),
-        .bus(master)
+        .control(dma_ctl),
+        .bus(masters[HART_COUNT])
+    );
+
+    BusArbiter #(.MASTER_COUNT(HART_COUNT+1)) bus_arbiter(
+        .clk(clock),
+        .rst(nreset),
+        .masters(masters),
+        .bus(arbitrated)
     );
 
     BusController bus_control(
         .clk(clock),
         .rst(nreset),
-        .bus(master),
+        .bus(arbitrated),
         .sel(sel),
         .slv_in(conn_in),
         .slv_out(conn_out)
     );
 
+    // Per hart signals, gathered so they can be indexed by a variable
+    logic [31:0]           hart_instruction [HART_COUNT];
+    logic [31:0]           hart_pc          [HART_COUNT];
+    logic [31:0]           hart_x           [HART_COUNT][16:1];
+    logic [63:0]           hart_stalls      [HART_COUNT];
+    logic [31:0]           hart_fetch_pc    [HART_COUNT];
+    logic                  hart_executing   [HART_COUNT];
+    logic [31:0]           hart_execute_pc  [HART_COUNT];
+    logic [31:0]           hart_execute_ins [HART_COUNT];
+    logic                  hart_skid_stall  [HART_COUNT];
+    logic [HART_COUNT-1:0] hart_quiescent;
+
+    for (genvar h = 0; h < HART_COUNT; h++) begin
+        assign hart_instruction[h] = harts[h].cu.fetch_out.data.instruction;
+        assign hart_pc[h]          = harts[h].cu.pc;
+        assign hart_x[h]           = harts[h].cu.register_file.x;
+        assign hart_stalls[h]      = harts[h].cu.fetch.stall_count;
+        assign hart_fetch_pc[h]    = harts[h].cu.fetch_out.data.address;
+        // Set for the cycle before the execute unit takes the instruction.
+        // Every instruction takes a single cycle for now, so ready is
+        // always set, but it keeps this to one cycle per instruction if
+        // the execute unit ever has to hold one back.
+        assign hart_executing[h]   
+            =  harts[h].cu.execute_in.valid 
+            && harts[h].cu.execute_in.ready;
+        assign hart_execute_pc[h]  = harts[h].cu.execute_in.data.pc;
+        assign hart_execute_ins[h] = harts[h].cu.execute_in.data.instruction;
+        assign hart_skid_stall[h]  
+            =  harts[h].cu.fetch_to_decode.stalled 
+            || harts[h].cu.decode_to_execute.stalled;
+        assign hart_quiescent[h]   = harts[h].cu.quiescent;
+    end
+
     // Allow the simulation to access specific internal signals
     `define EXPOSE_SIGNAL(ARGS, VALUE, NAME, TYPE) \
         function TYPE NAME ARGS;                   \
@@ -77,19 +172,42 @@ module Top (
         endfunction                         
     
     `EXPOSE_SIGNAL(
-        (), cu.fetch_out.data.instruction, sig_instruction, bit[31:0]
+        (input [31:0] h), hart_instruction[h], sig_instruction, bit[31:0]
+    );
+    `EXPOSE_SIGNAL(
+        (input [31:0] h), hart_pc[h], sig_pc, bit[31:0]
+    );
+    `EXPOSE_SIGNAL(
+        (input [31:0] h), hart_stalls[h], sig_stall_cycles, bit[63:0]
+    );
+    `EXPOSE_SIGNAL(
+        (input [31:0] h), hart_fetch_pc[h], sig_fetch_pc, bit[31:0]
+    );
+    `EXPOSE_SIGNAL(
+        (input [31:0] h), hart_executing[h], sig_executing, bit
+    );
+    `EXPOSE_SIGNAL(
+        (input [31:0] h), hart_execute_pc[h], sig_execute_pc, bit[31:0]
+    );
+    `EXPOSE_SIGNAL(
+        (input [31:0] h), hart_execute_ins[h], sig_execute_instruction, bit[31:0]
+    );
+    `EXPOSE_SIGNAL(
+        (input [31:0] h), hart_skid_stall[h], sig_skid_stalled, bit
     );
     `EXPOSE_SIGNAL(
-        (), cu.pc, sig_pc, bit[31:0]
+        (), &hart_quiescent && !dma_ctl.busy, sig_quiescent, bit
     );
     `EXPOSE_SIGNAL(
-        (input [3:0] i), cu.register_file.x[i], sig_register, bit[31:0]
+        (input [31:0] h, input [3:0] i), 
+        i == 0 ? 0 : hart_x[h][i], 
+        sig_register, 
+        bit[31:0]
     );
 
-    task write_sig_register (input [3:0] i, input [31:0] value); 
+    task write_sig_register(input [31:0] h, input [3:0] i, input [31:0] value); 
         /* verilator public */
-        if (i > 0)
-            cu.register_file.x[i] = value;
+        harts[0].dispatch.write_register(h, i, value);
     endtask
 endmodule
 
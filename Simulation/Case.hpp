@@ -116,12 +116,17 @@ private:
     template<TestCase ...Tfs>
     friend void run_tests(
         std::shared_ptr<VerilatedContext> ctx, 
+        FunctionalCoverage &coverage,
         Tfs ...tests
     );
 };
 
 template<TestCase ...Tfs>
-void run_tests(std::shared_ptr<VerilatedContext> ctx, Tfs ...tests)
+void run_tests(
+    std::shared_ptr<VerilatedContext> ctx, 
+    FunctionalCoverage &coverage,
+    Tfs ...tests
+)
 {
     usize tests_passed = 0;
     usize out_of       = sizeof...(Tfs);
@@ -130,6 +135,10 @@ void run_tests(std::shared_ptr<VerilatedContext> ctx, Tfs ...tests)
     ([&] {
         auto sim = MainDesign(ctx);
         auto test_ctx = TestContext(test_number);
+        coverage.clear_history();
+        sim.set_execute_hook([&](usize hart, u32 inst) {
+            coverage.record(hart, inst);
+        });
         tests(sim, test_ctx);
 
         bool passed = test_ctx.finish();
@@ -0,0 +1,23 @@
+#include "Common.hpp"
+#include "Device.hpp"
+#include "Memory.hpp"
+#include "Uart.hpp"
+#include "Dma.hpp"
+#include "Model.hpp"
+#include "Disasm.hpp"
+#include "Design.hpp"
+#include "Coverage.hpp"
+
+// Merges the functional coverage written by several test runs and 
+// reports on the bins none of them hit
+int main(int argc, const char **argv)
+{
+    auto coverage = FunctionalCoverage();
+    for (int i = 1; i < argc; ++i) {
+        if (!coverage.merge(argv[i])) {
+            std::println(stderr, "Couldn't read coverage from {}", argv[i]);
+            return 1;
+        }
+    }
+    coverage.report();
+}
@@ -0,0 +1,257 @@
+#include <array>
+#include <vector>
+#include <optional>
+#include <fstream>
+#include <string>
+#include <print>
+
+// Bitmask of a set of funct3 values
+constexpr u8 funct3s(auto ...f3)
+{
+    return ((1 << f3) | ...);
+}
+
+// Functional coverage of the instruction stream. Each executed instruction
+// is binned by opcode, funct3, and which of its source registers were
+// written by the instruction executed just before it on the same hart.
+class FunctionalCoverage
+{
+public:
+    enum Hazard {
+        HAZARD_NONE,
+        HAZARD_RS1,
+        HAZARD_RS2,
+        HAZARD_BOTH,
+        HAZARD_COUNT
+    };
+
+    struct Bin
+    {
+        u32 opcode;
+        u32 funct3;
+        Hazard hazard;
+    };
+
+private:
+    struct Format
+    {
+        u32 opcode;
+        const char *name;
+        bool has_funct3;
+        u8 valid_funct3; // Bitmask of funct3 values which are defined
+        bool reads_rs1;
+        bool reads_rs2;
+        bool writes_rd;
+        // Whether the core executes it yet, as only those bins are counted
+        bool implemented;
+    };
+
+    static constexpr std::array formats {
+        Format { Opcodes::OPCODE_LUI,   "lui",   false, 0x01, false, false, true,  true },
+        Format { Opcodes::OPCODE_AUIPC, "auipc", false, 0x01, false, false, true,  true },
+        Format { Opcodes::OPCODE_JAL,   "jal",   false, 0x01, false, false, true,  true },
+        Format { Opcodes::OPCODE_JALR,  "jalr",  true,  0x01, true,  false, true,  true },
+        Format {
+            Opcodes::OPCODE_SOME_OP_IMM, "op-imm", true, 0xFF, true, false, true, true
+        },
+        Format {
+            Opcodes::OPCODE_SOME_OP_REG, "op-reg", true, 0xFF, true, true, true, true
+        },
+        Format {
+            Opcodes::OPCODE_SOME_BRANCH, "branch", true,
+            funct3s(
+                BranchF3::BRANCH_EQ,
+                BranchF3::BRANCH_NOT_EQ,
+                BranchF3::BRANCH_LESS_THAN_SIGNED,
+                BranchF3::BRANCH_GREATER_OR_EQ_SIGNED,
+                BranchF3::BRANCH_LESS_THAN_UNSIGNED,
+                BranchF3::BRANCH_GREATER_OR_EQ_UNSIGNED
+            ),
+            true, true, false, false
+        },
+        Format {
+            Opcodes::OPCODE_SOME_LOAD, "load", true,
+            funct3s(
+                LoadF3::LOAD_BYTE,
+                LoadF3::LOAD_HALFWORD,
+                LoadF3::LOAD_WORD,
+                LoadF3::LOAD_BYTE_UPPER,
+                LoadF3::LOAD_HALFWORD_UPPER
+            ),
+            true, false, true, false
+        },
+        Format {
+            Opcodes::OPCODE_SOME_STORE, "store", true,
+            funct3s(
+                StoreF3::STORE_BYTE,
+                StoreF3::STORE_HALFWORD,
+                StoreF3::STORE_WORD
+            ),
+            true, true, false, false
+        },
+    };
+
+    using Bins = std::array<
+        std::array<std::array<u64, HAZARD_COUNT>, 8>,
+        formats.size()
+    >;
+    Bins bins = {};
+    std::array<std::optional<u32>, params::hart_count> previous;
+
+public:
+    void record(usize hart, u32 inst)
+    {
+        auto last = previous[hart];
+        previous[hart] = inst;
+
+        auto index = find_format(inst & 0x7F);
+        if (!index) {
+            return;
+        }
+        auto &format = formats[*index];
+        u32 funct3 = format.has_funct3 ? (inst >> 12) & 0x7 : 0;
+        if (!(format.valid_funct3 >> funct3 & 1)) {
+            return;
+        }
+
+        bool rs1 = false;
+        bool rs2 = false;
+        if (last) {
+            auto last_format = find_format(*last & 0x7F);
+            u32 rd = *last >> 7 & 0x1F;
+            if (last_format && formats[*last_format].writes_rd && rd != 0) {
+                rs1 = format.reads_rs1 && (inst >> 15 & 0x1F) == rd;
+                rs2 = format.reads_rs2 && (inst >> 20 & 0x1F) == rd;
+            }
+        }
+        ++bins[*index][funct3][hazard_of(rs1, rs2)];
+    }
+
+    // The next instruction recorded doesn't follow on from the last one,
+    // such as after a reset
+    void clear_history()
+    {
+        previous.fill(std::nullopt);
+    }
+
+    std::vector<Bin> uncovered() const
+    {
+        std::vector<Bin> result;
+        for_each_bin([&](usize i, u32 funct3, Hazard hazard) {
+            if (bins[i][funct3][hazard] == 0) {
+                result.push_back(Bin { formats[i].opcode, funct3, hazard });
+            }
+        });
+        return result;
+    }
+
+    // One line per bin of "opcode funct3 hazard count"
+    bool write(const std::string &path) const
+    {
+        auto file = std::ofstream(path);
+        for_each_bin([&](usize i, u32 funct3, Hazard hazard) {
+            file << formats[i].opcode << ' ' << funct3 << ' ' << hazard << ' '
+                 << bins[i][funct3][hazard] << '\n';
+        });
+        return file.good();
+    }
+
+    // Add the counts from a file produced by write()
+    bool merge(const std::string &path)
+    {
+        auto file = std::ifstream(path);
+        if (!file) {
+            return false;
+        }
+        u32 opcode, funct3, hazard;
+        u64 count;
+        while (file >> opcode >> funct3 >> hazard >> count) {
+            auto index = find_format(opcode);
+            if (!index || funct3 >= 8 || hazard >= HAZARD_COUNT) {
+                return false;
+            }
+            bins[*index][funct3][hazard] += count;
+        }
+        return file.eof();
+    }
+
+    void report() const
+    {
+        constexpr const char *hazard_names[] = {
+            "no hazard", "rs1 hazard", "rs2 hazard", "rs1 and rs2 hazard"
+        };
+        usize hit = 0;
+        usize total = 0;
+        for_each_bin([&](usize i, u32 funct3, Hazard hazard) {
+            ++total;
+            auto count = bins[i][funct3][hazard];
+            if (count > 0) {
+                ++hit;
+                return;
+            }
+            std::println(
+                "  uncovered: {} funct3={:03b} {}",
+                formats[i].name,
+                funct3,
+                hazard_names[hazard]
+            );
+        });
+        std::println(
+            "Functional coverage: {} / {} bins hit ({:.1f}%)",
+            hit,
+            total,
+            total ? 100.0 * hit / total : 0.0
+        );
+        for (auto &format : formats) {
+            if (!format.implemented) {
+                std::println("  excluded, not executed by the core: {}", format.name);
+            }
+        }
+    }
+
+private:
+    static constexpr std::optional<usize> find_format(u32 opcode)
+    {
+        for (usize i = 0; i < formats.size(); ++i) {
+            if (formats[i].opcode == opcode) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    static constexpr Hazard hazard_of(bool rs1, bool rs2)
+    {
+        if (rs1 && rs2) {
+            return HAZARD_BOTH;
+        }
+        return rs1 ? HAZARD_RS1 : rs2 ? HAZARD_RS2 : HAZARD_NONE;
+    }
+
+    // Visit every bin which can actually be hit
+    template<typename F>
+    static void for_each_bin(F f)
+    {
+        for (usize i = 0; i < formats.size(); ++i) {
+            auto &format = formats[i];
+            if (!format.implemented) {
+                continue;
+            }
+            for (u32 funct3 = 0; funct3 < 8; ++funct3) {
+                if (!(format.valid_funct3 >> funct3 & 1)) {
+                    continue;
+                }
+                for (u32 h = 0; h < HAZARD_COUNT; ++h) {
+                    auto hazard = static_cast<Hazard>(h);
+                    bool needs_rs1 = hazard == HAZARD_RS1 || hazard == HAZARD_BOTH;
+                    bool needs_rs2 = hazard == HAZARD_RS2 || hazard == HAZARD_BOTH;
+                    if ((needs_rs1 && !format.reads_rs1)
+                    ||  (needs_rs2 && !format.reads_rs2)) {
+                        continue;
+                    }
+                    f(i, funct3, hazard);
+                }
+            }
+        }
+    }
+};
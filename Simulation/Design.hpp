@@ -3,27 +3,17 @@
 #include <functional>
 #include <ranges>
 #include <iterator>
+#include <algorithm>
+#include <tuple>
+#include <utility>
 
-#include "verilated.h"
-#include "VTop__Dpi.h"
-#include "VTop.h"
-#include "VTop___024unit.h"
-#include "VTop_Top.h"
+// Called with the hart and instruction word whenever a hart is about to
+// execute an instruction, so wrong path fetches which get flushed are left out
+using ExecuteHook = std::function<void(usize, u32)>;
 
-namespace params
-{
-constexpr auto device_count = VTop___024unit::AHB_DEVICE_COUNT;
-constexpr auto address_map  = VTop___024unit::AHB_ADDR_MAP;
-}
-
-using Opcodes  = VTop___024unit::opcode_field;
-using OpImmF3  = VTop___024unit::funct3_op_imm;
-using OpRegF3  = VTop___024unit::funct3_op_reg;
-using RShiftF7 = VTop___024unit::funct7_r_shift_kind;
-using ArithF7  = VTop___024unit::funct7_reg_arith;
-using BranchF3 = VTop___024unit::funct3_branch;
-using LoadF3   = VTop___024unit::funct3_load;
-using StoreF3  = VTop___024unit::funct3_store;
+// Called after every cycle with the number of cycles that passed, which is
+// more than one when idle cycles were skipped
+using CycleHook = std::function<void(usize)>;
 
 template<BusDevice ...Devices> 
 requires (sizeof...(Devices) == params::device_count)
@@ -37,14 +27,27 @@ class Design
     std::unique_ptr<VTop> top;
     DeviceMap devices;
     bool logging = false;
+    bool fast_forward = true;
     usize cycle_count = 0;
+    usize skipped_count = 0;
+    // Stalled cycles which were skipped rather than simulated
+    std::array<u64, params::hart_count> skipped_stalls = {};
+    ExecuteHook execute_hook;
+    CycleHook cycle_hook;
+    Disassembler disassembler;
 
 public:
+    // After a reset each hart finds its index in this register, the thread
+    // pointer in the usual calling convention, so harts running the same
+    // code can tell themselves apart
+    static constexpr u32 hart_id_register = 4;
+
     Design(std::shared_ptr<VerilatedContext> ctx)
     : context(ctx)
     , top(new VTop{context.get()})
     , devices(init_devices())
     {
+        connect_devices();
         top->nreset = 1;
         top->clock = 0;
         top->eval();
@@ -72,6 +75,8 @@ public:
         }
     }
 
+    // Exactly one cycle, never skipping any. step() and do_cycles() are
+    // the ones which fast forward.
     void cycle() 
     {
         log("Doing clock cycle {}", ++cycle_count);
@@ -83,12 +88,33 @@ public:
         top->eval();
         log("Evaluating devices");
         eval_devices();
+        if (execute_hook) {
+            for (usize h = 0; h < params::hart_count; ++h) {
+                if (top->Top->sig_executing(h)) {
+                    execute_hook(h, top->Top->sig_execute_instruction(h));
+                }
+            }
+        }
+        if (cycle_hook) {
+            cycle_hook(1);
+        }
+    }
+
+    // One cycle, followed by any idle cycles which can be skipped without
+    // going over max in total. Returns how many cycles passed.
+    usize step(usize max)
+    {
+        if (max == 0) {
+            return 0;
+        }
+        cycle();
+        return 1 + skip_idle_cycles(max - 1);
     }
 
     void do_cycles(usize count)
     {
-        while (count--) {
-            cycle();
+        while (count > 0) {
+            count -= step(count);
         }
     }
 
@@ -98,6 +124,11 @@ public:
         top->nreset = 0;
         cycle();
         top->nreset = 1;
+        skipped_stalls.fill(0);
+        // Hart 0 keeps the zero it was reset to
+        for (usize h = 1; h < params::hart_count; ++h) {
+            write_register(hart_id_register, h, h);
+        }
     }
 
     void write_word(u32 addr, u32 value)
@@ -105,6 +136,11 @@ public:
         mux_devices(addr)->write(addr, value);
     }
 
+    u32 read_word(u32 addr)
+    {
+        return mux_devices(addr)->read(addr);
+    }
+
     template<typename T>
     requires std::ranges::range<T> 
     && std::is_same_v<std::ranges::range_value_t<T>, u32>
@@ -115,9 +151,55 @@ public:
         }
     }
 
-    std::string disassemble(u32 instruction) 
+    const std::string &disassemble(u32 instruction) 
+    {
+        return disassembler(instruction);
+    }
+
+    // Names the target of a jump or branch found at the given address
+    const std::string &disassemble(u32 instruction, u32 pc) 
+    {
+        return disassembler(instruction, pc);
+    }
+
+    // Symbols for disassembly, from the ELF file a program was linked into
+    bool load_symbols(const std::string &path)
+    {
+        return disassembler.load_symbols(path);
+    }
+
+    // Jump over cycles where the core is only waiting on a slow device
+    void set_fast_forward(bool f)
+    {
+        fast_forward = f;
+    }
+
+    void set_execute_hook(ExecuteHook hook)
+    {
+        execute_hook = std::move(hook);
+    }
+
+    void set_cycle_hook(CycleHook hook)
+    {
+        cycle_hook = std::move(hook);
+    }
+
+    usize cycles() const
+    {
+        return cycle_count;
+    }
+
+    // How many of cycles() were skipped rather than simulated
+    usize skipped_cycles() const
     {
-        return top->__024unit->disassemble(instruction);
+        return skipped_count;
+    }
+
+    template<usize I>
+    auto &device()
+    {
+        using T = std::tuple_element_t<I, std::tuple<Devices...>>;
+        return static_cast<T &>(*devices[I]);
     }
 
     void set_logging(bool l)
@@ -126,24 +208,53 @@ public:
         top->__024unit->set_logging(l);
     }
 
-    u32 read_register(usize i) 
+    u32 read_register(usize i, usize hart = 0) 
     {
-        return top->Top->sig_register(i);
+        return top->Top->sig_register(hart, i);
     }
 
-    void write_register(usize i, u32 value) 
+    void write_register(usize i, u32 value, usize hart = 0) 
     {
-        top->Top->write_sig_register(i, value);
+        top->Top->write_sig_register(hart, i, value);
+        // Settle anything reading the register file, without a clock edge
+        top->eval();
+    }
+
+    u32 read_instruction(usize hart = 0) const
+    {
+        return top->Top->sig_instruction(hart);
+    }
+
+    u32 read_program_counter(usize hart = 0) const
+    {
+        return top->Top->sig_pc(hart);
+    }
+
+    // Address the hart is fetching from, or last fetched from
+    u32 read_fetch_address(usize hart = 0) const
+    {
+        return top->Top->sig_fetch_pc(hart);
+    }
+
+    // Address of the instruction the hart starts executing next cycle, if any
+    std::optional<u32> read_execute_address(usize hart = 0) const
+    {
+        if (!top->Top->sig_executing(hart)) {
+            return std::nullopt;
+        }
+        return top->Top->sig_execute_pc(hart);
     }
 
-    u32 read_instruction() const
+    // Whether either of the hart's skid buffers is holding a value back
+    bool read_skid_stalled(usize hart = 0) const
     {
-        return top->Top->sig_instruction();
+        return top->Top->sig_skid_stalled(hart);
     }
 
-    u32 read_program_counter() const
+    // Cycles the hart's fetch spent waiting on the bus
+    u64 read_stall_cycles(usize hart = 0) const
     {
-        return top->Top->sig_pc();
+        return top->Top->sig_stall_cycles(hart) + skipped_stalls[hart];
     }
 
 private:
@@ -155,20 +266,78 @@ private:
         }
     }
 
+    usize skip_idle_cycles(usize max)
+    {
+        if (!fast_forward || max == 0 || !top->Top->sig_quiescent()) {
+            return 0;
+        }
+        // About to wake the DMA unit up
+        if (top->dma_start) {
+            return 0;
+        }
+        // Only the selected device can wake the core up
+        for (auto [i, dev] : std::views::enumerate(devices)) {
+            if (!top->ext_sel[i]) {
+                continue;
+            }
+            usize count = std::min(dev->stall_cycles(), max);
+            if (count > 0) {
+                log("Skipping {} idle cycles", count);
+                dev->skip_cycles(count);
+                cycle_count += count;
+                skipped_count += count;
+                // Every hart is waiting on a fetch reply
+                for (auto &stalls : skipped_stalls) {
+                    stalls += count;
+                }
+                if (cycle_hook) {
+                    cycle_hook(count);
+                }
+            }
+            return count;
+        }
+        return 0;
+    }
+
     std::unique_ptr<BusDeviceBase> &mux_devices(u32 addr)
     {
-        usize current = 0;
         usize i = 0;
-        for (i = 0; i < params::device_count - 1; ++i) {
-            usize top = params::address_map[i];
-            if (current < top) {
-                break;
-            }
-            current = top;
+        while (i < params::device_count - 1 && addr >= params::address_map[i]) {
+            ++i;
         }
         return devices[i];
     }
     
+    // Hook up devices which need more than the bus
+    void connect_devices()
+    {
+        [&]<usize ...Is>(std::index_sequence<Is...>) {
+            (connect_device<Is>(), ...);
+        }(std::index_sequence_for<Devices...>{});
+    }
+
+    template<usize I>
+    void connect_device()
+    {
+        using T = std::tuple_element_t<I, std::tuple<Devices...>>;
+        if constexpr (DmaController<T>) {
+            device<I>().connect(
+                DmaSignals {
+                    .start       = top->dma_start,
+                    .acknowledge = top->dma_acknowledge,
+                    .source      = top->dma_source,
+                    .destination = top->dma_destination,
+                    .length      = top->dma_length,
+                    .busy        = top->dma_busy,
+                    .done        = top->dma_irq
+                },
+                [this](u32 addr) -> BusDeviceBase & {
+                    return *mux_devices(addr);
+                }
+            );
+        }
+    }
+
     static DeviceMap init_devices()
     {
         usize i = 0;
@@ -193,5 +362,5 @@ private:
     }
 };
 
-using MainDesign = Design<MemDevice, NCDevice>;
+using MainDesign = Design<MemDevice, UartDevice, DmaDevice, NCDevice>;
 
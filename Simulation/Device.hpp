@@ -1,4 +1,5 @@
 #include <concepts>
+#include <functional>
 
 struct BusDeviceSignals
 { 
@@ -13,6 +14,18 @@ struct BusDeviceSignals
     u8 &response;
 };
 
+// Control ports of the DMA unit, for the device which programs it
+struct DmaSignals
+{
+    u8 &start;
+    u8 &acknowledge;
+    u32 &source;
+    u32 &destination;
+    u32 &length;
+    const u8 &busy;
+    const u8 &done;
+};
+
 struct AddressRange
 {
     u32 begin;
@@ -21,9 +34,24 @@ struct AddressRange
 
 struct BusDeviceBase
 {
+    // Devices are owned and destroyed through this base
+    virtual ~BusDeviceBase() = default;
+
     virtual void write(u32, u32) = 0;
     virtual u32 read(u32) = 0;
     virtual void evaluate(BusDeviceSignals) = 0;
+
+    // How many more evaluations the device will keep the bus not ready 
+    // for, regardless of what the core does in the meantime
+    virtual usize stall_cycles() 
+    {
+        return 0;
+    }
+
+    // Advance the device's notion of time without evaluating the bus, 
+    // for at most stall_cycles() cycles
+    virtual void skip_cycles(usize)
+    {}
 };
 
 template<typename T>
@@ -31,6 +59,16 @@ concept BusDevice
     =  std::derived_from<T, BusDeviceBase>
     && std::constructible_from<T, AddressRange>;
 
+// Finds the device behind an address, for devices which reach the others
+// directly from the host
+using DeviceResolver = std::function<BusDeviceBase &(u32)>;
+
+// Devices which drive the DMA unit as well as sitting on the bus
+template<typename T>
+concept DmaController = requires(T &d, DmaSignals s, DeviceResolver r) {
+    d.connect(s, r);
+};
+
 struct NCDevice : public BusDeviceBase
 {
     NCDevice(AddressRange) 
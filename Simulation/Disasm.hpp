@@ -0,0 +1,361 @@
+#include <elf.h>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Native counterpart of disassemble() in Disasm.svh, which builds its
+// strings inside the model and is slow to call for every line of a trace.
+// Each instruction word is only formatted once, and when symbols have been
+// loaded, jump and branch targets are named after them.
+class Disassembler
+{
+    std::unordered_map<u32, std::string> cache;
+    // Text with the target symbol added, keyed by address and word
+    std::unordered_map<u64, std::string> located;
+    std::map<u32, std::string> symbols;
+
+public:
+    const std::string &operator()(u32 inst)
+    {
+        auto [it, inserted] = cache.try_emplace(inst);
+        if (inserted) {
+            it->second = format(inst);
+        }
+        return it->second;
+    }
+
+    // As above, with the target of a jump or branch at the given address
+    // shown as "<symbol+offset>"
+    const std::string &operator()(u32 inst, u32 pc)
+    {
+        auto target = target_of(inst, pc);
+        if (!target || symbols.empty()) {
+            return (*this)(inst);
+        }
+        auto [it, inserted] = located.try_emplace(u64 { pc } << 32 | inst);
+        if (inserted) {
+            auto name = symbolise(*target);
+            it->second = name
+                ? std::format("{} <{}>", (*this)(inst), *name)
+                : (*this)(inst);
+        }
+        return it->second;
+    }
+
+    void add_symbol(u32 address, std::string name)
+    {
+        symbols.insert_or_assign(address, std::move(name));
+        located.clear();
+    }
+
+    // Name of the closest symbol at or below the address, with the offset
+    // from it if there is one
+    std::optional<std::string> symbolise(u32 address) const
+    {
+        auto it = symbols.upper_bound(address);
+        if (it == symbols.begin()) {
+            return std::nullopt;
+        }
+        --it;
+        if (it->first == address) {
+            return it->second;
+        }
+        return std::format("{}+0x{:x}", it->second, address - it->first);
+    }
+
+    // Read the symbol table of a 32 bit little endian ELF file, such as
+    // the ones the programs in Code/ are linked into
+    bool load_symbols(const std::string &path)
+    {
+        auto file = std::ifstream(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::vector<char> data(std::istreambuf_iterator<char>(file), {});
+        auto read = [&]<typename T>(usize offset, T &out) {
+            if (offset > data.size() || data.size() - offset < sizeof(T)) {
+                return false;
+            }
+            std::memcpy(&out, data.data() + offset, sizeof(T));
+            return true;
+        };
+
+        Elf32_Ehdr header;
+        if (!read(0, header)
+        ||  std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0
+        ||  header.e_ident[EI_CLASS] != ELFCLASS32
+        ||  header.e_ident[EI_DATA] != ELFDATA2LSB) {
+            return false;
+        }
+
+        for (usize i = 0; i < header.e_shnum; ++i) {
+            Elf32_Shdr section, strings;
+            if (!read(header.e_shoff + i * header.e_shentsize, section)) {
+                return false;
+            }
+            if (section.sh_type != SHT_SYMTAB) {
+                continue;
+            }
+            auto link = header.e_shoff + section.sh_link * header.e_shentsize;
+            if (!read(link, strings)) {
+                return false;
+            }
+            for (usize j = 0; j < section.sh_size / sizeof(Elf32_Sym); ++j) {
+                Elf32_Sym symbol;
+                if (!read(section.sh_offset + j * sizeof(Elf32_Sym), symbol)) {
+                    return false;
+                }
+                auto type = ELF32_ST_TYPE(symbol.st_info);
+                if (symbol.st_name == 0
+                ||  symbol.st_shndx == SHN_UNDEF
+                ||  symbol.st_shndx == SHN_ABS
+                ||  (type != STT_NOTYPE && type != STT_FUNC)) {
+                    continue;
+                }
+                usize offset = strings.sh_offset + symbol.st_name;
+                if (offset >= data.size()) {
+                    return false;
+                }
+                auto name = std::string_view(
+                    data.data() + offset,
+                    strnlen(data.data() + offset, data.size() - offset)
+                );
+                // Skip assembler local labels and mapping symbols
+                if (name.starts_with(".L") || name.starts_with('$')) {
+                    continue;
+                }
+                symbols.try_emplace(symbol.st_value, name);
+            }
+            located.clear();
+            return true;
+        }
+        return false;
+    }
+
+    // Address a jump or branch goes to, when it doesn't depend on a register
+    static std::optional<u32> target_of(u32 inst, u32 pc)
+    {
+        switch (inst & 0x7F) {
+        case Opcodes::OPCODE_JAL:         return pc + j_immediate(inst);
+        case Opcodes::OPCODE_SOME_BRANCH: return pc + b_immediate(inst);
+        default:                          return std::nullopt;
+        }
+    }
+
+private:
+    static std::string format(u32 inst)
+    {
+        u32 rd     = inst >> 7  & 0x1F;
+        u32 funct3 = inst >> 12 & 0x7;
+        u32 rs1    = inst >> 15 & 0x1F;
+        u32 rs2    = inst >> 20 & 0x1F;
+        u32 funct7 = inst >> 25;
+
+        switch (inst & 0x7F) {
+        case Opcodes::OPCODE_LUI:
+            return std::format("lui {}, {}", reg(rd), inst >> 12);
+        case Opcodes::OPCODE_AUIPC:
+            return std::format("auipc {}, {}", reg(rd), inst >> 12);
+        case Opcodes::OPCODE_JAL:
+            return std::format(
+                "jal {}, {}", reg(rd), static_cast<s32>(j_immediate(inst))
+            );
+        case Opcodes::OPCODE_JALR:
+            return std::format(
+                "jalr {}, {}, {}", reg(rd), reg(rs1), i_immediate(inst)
+            );
+        case Opcodes::OPCODE_SOME_OP_IMM:
+            return format_op_imm(inst, rd, funct3, rs1, rs2, funct7);
+        case Opcodes::OPCODE_SOME_OP_REG:
+            return format_op_reg(rd, funct3, rs1, rs2, funct7);
+        case Opcodes::OPCODE_SOME_BRANCH:
+            return format_branch(inst, funct3, rs1, rs2);
+        case Opcodes::OPCODE_SOME_LOAD:
+            return format_load(inst, rd, funct3, rs1);
+        case Opcodes::OPCODE_SOME_STORE:
+            return format_store(inst, funct3, rs1, rs2);
+        case Opcodes::OPCODE_SOME_MISC_MEM:
+        case Opcodes::OPCODE_SOME_SYSTEM:
+            return "not implemented";
+        default:
+            return std::format(
+                "an invalid instruction: opcode=({:07b})", inst & 0x7F
+            );
+        }
+    }
+
+    static std::string format_op_imm(
+        u32 inst, u32 rd, u32 funct3, u32 rs1, u32 rs2, u32 funct7)
+    {
+        std::string_view name;
+        switch (funct3) {
+        case OpImmF3::OP_IMM_ADDI:  name = "addi";  break;
+        case OpImmF3::OP_IMM_SLTI:  name = "slti";  break;
+        case OpImmF3::OP_IMM_SLTIU: name = "sltiu"; break;
+        case OpImmF3::OP_IMM_XORI:  name = "xori";  break;
+        case OpImmF3::OP_IMM_ORI:   name = "ori";   break;
+        case OpImmF3::OP_IMM_ANDI:  name = "andi";  break;
+        case OpImmF3::OP_IMM_SLLI:
+            return std::format("slli {}, {}, {}", reg(rd), reg(rs1), rs2);
+        case OpImmF3::OP_IMM_SOME_SHIFT_R:
+            switch (funct7) {
+            case RShiftF7::SHIFT_R_LOGIC: name = "srli"; break;
+            case RShiftF7::SHIFT_R_ARITH: name = "srai"; break;
+            default:
+                return std::format(
+                    "an invalid register-immediate right shift, "
+                    "funct7=({:07b})",
+                    funct7
+                );
+            }
+            return std::format("{} {}, {}, {}", name, reg(rd), reg(rs1), rs2);
+        }
+        return std::format(
+            "{} {}, {}, {}", name, reg(rd), reg(rs1), i_immediate(inst)
+        );
+    }
+
+    static std::string format_op_reg(
+        u32 rd, u32 funct3, u32 rs1, u32 rs2, u32 funct7)
+    {
+        auto invalid = std::format(
+            "an invalid register-register operation, funct7=({:07b})", funct7
+        );
+        std::string_view name;
+        switch (funct3) {
+        case OpRegF3::OP_REG_SLL:  name = "sll";  break;
+        case OpRegF3::OP_REG_SLT:  name = "slt";  break;
+        case OpRegF3::OP_REG_SLTU: name = "sltu"; break;
+        case OpRegF3::OP_REG_XOR:  name = "xor";  break;
+        case OpRegF3::OP_REG_OR:   name = "or";   break;
+        case OpRegF3::OP_REG_AND:  name = "and";  break;
+        case OpRegF3::OP_REG_SOME_ARITH:
+            switch (funct7) {
+            case ArithF7::ARITH_REG_ADD: name = "add"; break;
+            case ArithF7::ARITH_REG_SUB: name = "sub"; break;
+            default:                     return invalid;
+            }
+            break;
+        case OpRegF3::OP_REG_SOME_SHIFT_R:
+            switch (funct7) {
+            case RShiftF7::SHIFT_R_LOGIC: name = "srl"; break;
+            case RShiftF7::SHIFT_R_ARITH: name = "sra"; break;
+            default:                      return invalid;
+            }
+            break;
+        }
+        // Only the arithmetic and right shift operations use funct7
+        if (funct7 != 0 
+        &&  funct3 != OpRegF3::OP_REG_SOME_ARITH 
+        &&  funct3 != OpRegF3::OP_REG_SOME_SHIFT_R) {
+            return invalid;
+        }
+        return std::format(
+            "{} {}, {}, {}", name, reg(rd), reg(rs1), reg(rs2)
+        );
+    }
+
+    static std::string format_branch(u32 inst, u32 funct3, u32 rs1, u32 rs2)
+    {
+        std::string_view name;
+        switch (funct3) {
+        case BranchF3::BRANCH_EQ:                     name = "beq";  break;
+        case BranchF3::BRANCH_NOT_EQ:                 name = "bne";  break;
+        case BranchF3::BRANCH_LESS_THAN_SIGNED:       name = "blt";  break;
+        case BranchF3::BRANCH_GREATER_OR_EQ_SIGNED:   name = "bge";  break;
+        case BranchF3::BRANCH_LESS_THAN_UNSIGNED:     name = "bltu"; break;
+        case BranchF3::BRANCH_GREATER_OR_EQ_UNSIGNED: name = "bgeu"; break;
+        default:
+            return std::format(
+                "an invalid branch instruction, funct3=({:03b})", funct3
+            );
+        }
+        return std::format(
+            "{} {}, {}, {}",
+            name,
+            reg(rs1),
+            reg(rs2),
+            static_cast<s32>(b_immediate(inst))
+        );
+    }
+
+    static std::string format_load(u32 inst, u32 rd, u32 funct3, u32 rs1)
+    {
+        std::string_view name;
+        switch (funct3) {
+        case LoadF3::LOAD_BYTE:           name = "lb";  break;
+        case LoadF3::LOAD_HALFWORD:       name = "lh";  break;
+        case LoadF3::LOAD_WORD:           name = "lw";  break;
+        case LoadF3::LOAD_BYTE_UPPER:     name = "lbu"; break;
+        case LoadF3::LOAD_HALFWORD_UPPER: name = "lhu"; break;
+        default:
+            return std::format(
+                "an invalid load instruction, funct3=({:03b})", funct3
+            );
+        }
+        return std::format(
+            "{} {}, {}({})", name, reg(rd), i_immediate(inst), reg(rs1)
+        );
+    }
+
+    static std::string format_store(u32 inst, u32 funct3, u32 rs1, u32 rs2)
+    {
+        std::string_view name;
+        switch (funct3) {
+        case StoreF3::STORE_BYTE:     name = "sb"; break;
+        case StoreF3::STORE_HALFWORD: name = "sh"; break;
+        case StoreF3::STORE_WORD:     name = "sw"; break;
+        default:
+            return std::format(
+                "an invalid store instruction, funct3=({:03b})", funct3
+            );
+        }
+        return std::format(
+            "{} {}, {}({})", name, reg(rs2), s_immediate(inst), reg(rs1)
+        );
+    }
+
+    static std::string reg(u32 r)
+    {
+        return r < 16
+            ? std::format("x{}", r)
+            : std::format("(invalid register {})", r);
+    }
+
+    static s32 i_immediate(u32 inst)
+    {
+        return static_cast<s32>(inst) >> 20;
+    }
+
+    static s32 s_immediate(u32 inst)
+    {
+        return (static_cast<s32>(inst) >> 25) << 5 | (inst >> 7 & 0x1F);
+    }
+
+    static u32 b_immediate(u32 inst)
+    {
+        u32 offset
+            = (inst >> 31 & 0x1) << 12
+            | (inst >> 7  & 0x1) << 11
+            | (inst >> 25 & 0x3F) << 5
+            | (inst >> 8  & 0xF) << 1;
+        return static_cast<u32>(static_cast<s32>(offset << 19) >> 19);
+    }
+
+    static u32 j_immediate(u32 inst)
+    {
+        u32 offset
+            = (inst >> 31 & 0x1) << 20
+            | (inst >> 12 & 0xFF) << 12
+            | (inst >> 20 & 0x1) << 11
+            | (inst >> 21 & 0x3FF) << 1;
+        return static_cast<u32>(static_cast<s32>(offset << 11) >> 11);
+    }
+};
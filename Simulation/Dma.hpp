@@ -0,0 +1,185 @@
+#include <optional>
+#include <cstring>
+
+// Register interface to the DMA engine. With timing accuracy on, copies
+// are done by the DMA unit in the design as a second bus master. With it
+// off, the copy happens immediately on the host, directly between memory
+// backing stores where possible.
+//
+// Registers (word access only):
+//   +0x00 SOURCE      : byte address to copy from
+//   +0x04 DESTINATION : byte address to copy to
+//   +0x08 LENGTH      : number of bytes to copy, rounded down to words
+//   +0x0C CONTROL     : bit 0 starts a copy (write only),
+//                       bit 1 enables the completion interrupt
+//   +0x10 STATUS      : bit 0 set while copying, bit 1 set once done,
+//                       write to acknowledge completion
+//
+// Only the host can program these registers or poll STATUS, as the core
+// has no loads or stores and no interrupt input. The dma_irq line out of
+// the design only reflects the DMA unit, so it is only meaningful with
+// timing accuracy on. interrupt() covers both modes.
+class DmaDevice : public BusDeviceBase
+{
+    static constexpr u32 reg_source      = 0x00;
+    static constexpr u32 reg_destination = 0x04;
+    static constexpr u32 reg_length      = 0x08;
+    static constexpr u32 reg_control     = 0x0C;
+    static constexpr u32 reg_status      = 0x10;
+
+    static constexpr u32 control_start      = 1 << 0;
+    static constexpr u32 control_irq_enable = 1 << 1;
+    static constexpr u32 status_busy        = 1 << 0;
+    static constexpr u32 status_done        = 1 << 1;
+
+    u32 address_offset;
+    bool pending = false;
+
+    u32 source = 0;
+    u32 destination = 0;
+    u32 length = 0;
+    u32 control = 0;
+
+    bool timing_accurate = true;
+    bool start_requested = false;
+    bool acknowledge_requested = false;
+    bool host_done = false;
+
+    std::optional<DmaSignals> signals;
+    DeviceResolver resolve;
+
+public:
+    DmaDevice(AddressRange range)
+    : address_offset(range.begin)
+    {}
+
+    // Called by the design to hook the registers up to the DMA unit, and
+    // to give access to the other devices for host side copies
+    void connect(DmaSignals s, DeviceResolver r)
+    {
+        signals.emplace(s);
+        resolve = std::move(r);
+    }
+
+    void set_timing_accurate(bool t)
+    {
+        timing_accurate = t;
+    }
+
+    bool busy() const
+    {
+        // The unit only raises busy on the edge after seeing start
+        return start_requested
+            || (signals && (signals->start || signals->busy));
+    }
+
+    bool done() const
+    {
+        return host_done || (signals && signals->done);
+    }
+
+    // State of the completion interrupt line
+    bool interrupt() const
+    {
+        return (control & control_irq_enable) && done();
+    }
+
+    void write(u32 addr, u32 value) override
+    {
+        switch (addr - address_offset) {
+        case reg_source:      source = value;      break;
+        case reg_destination: destination = value; break;
+        case reg_length:      length = value;      break;
+        case reg_control:
+            control = value & control_irq_enable;
+            if (value & control_start) {
+                start();
+            }
+            break;
+        case reg_status:
+            host_done = false;
+            acknowledge_requested = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    u32 read(u32 addr) override
+    {
+        switch (addr - address_offset) {
+        case reg_source:      return source;
+        case reg_destination: return destination;
+        case reg_length:      return length;
+        case reg_control:     return control;
+        case reg_status:
+            return (busy() ? status_busy : 0) | (done() ? status_done : 0);
+        default:
+            return 0;
+        }
+    }
+
+    void evaluate(BusDeviceSignals bus) override
+    {
+        bus.us_ready = 1;
+        bus.response = 0;
+        if (!bus.sel || bus.trans != 2) {
+            pending = false;
+        } else if (!pending) {
+            pending = true;
+            if (bus.write) {
+                write(bus.addr, bus.write_data);
+            } else {
+                bus.read_data = read(bus.addr);
+            }
+        }
+
+        // Requests are held for a single cycle
+        if (signals) {
+            signals->start       = start_requested;
+            signals->acknowledge = acknowledge_requested;
+            signals->source      = source;
+            signals->destination = destination;
+            signals->length      = length;
+        }
+        start_requested = false;
+        acknowledge_requested = false;
+    }
+
+private:
+    void start()
+    {
+        if (timing_accurate && signals) {
+            start_requested = true;
+            return;
+        }
+        copy_now();
+        host_done = true;
+    }
+
+    void copy_now()
+    {
+        if (!resolve || length < 4) {
+            return;
+        }
+        u32 words = length / 4;
+        auto from = dynamic_cast<MemDevice *>(&resolve(source));
+        auto to   = dynamic_cast<MemDevice *>(&resolve(destination));
+        if (from && to) {
+            auto src = from->words(source, words);
+            auto dst = to->words(destination, words);
+            if (src.size() == words && dst.size() == words) {
+                // Note overlapping copies behave like memmove here, rather
+                // than the word by word order of the DMA unit
+                std::memmove(dst.data(), src.data(), words * sizeof(u32));
+                return;
+            }
+        }
+        // Not plain memory, so go through each device a word at a time
+        for (u32 i = 0; i < words; ++i) {
+            u32 from_addr = source + i * 4;
+            u32 to_addr   = destination + i * 4;
+            resolve(to_addr).write(to_addr, resolve(from_addr).read(from_addr));
+        }
+    }
+};
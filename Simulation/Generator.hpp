@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+u32 encode_r(u32 opcode, u32 rd, u32 funct3, u32 rs1, u32 rs2, u32 funct7)
+{
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+u32 encode_i(u32 opcode, u32 rd, u32 funct3, u32 rs1, s32 imm)
+{
+    return (imm & binary_ones(12)) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+u32 encode_b(u32 opcode, u32 funct3, u32 rs1, u32 rs2, s32 offset)
+{
+    u32 imm = offset;
+    u32 res = opcode | funct3 << 12 | rs1 << 15 | rs2 << 20;
+    res |= (imm >> 11 & 1)              << 7;  // inst[7]
+    res |= (imm >> 1  & binary_ones(4)) << 8;  // inst[11:8]
+    res |= (imm >> 5  & binary_ones(6)) << 25; // inst[30:25]
+    res |= (imm >> 12 & 1)              << 31; // inst[31]
+    return res;
+}
+
+u32 encode_u(u32 opcode, u32 rd, u32 upper)
+{
+    return upper << 12 | rd << 7 | opcode;
+}
+
+u32 encode_j(u32 opcode, u32 rd, s32 offset)
+{
+    u32 imm = offset;
+    u32 res = opcode | rd << 7;
+    res |= (imm >> 12 & binary_ones(8))  << 12; // inst[19:12]
+    res |= (imm >> 11 & 1)               << 20; // inst[20]
+    res |= (imm >> 1  & binary_ones(10)) << 21; // inst[30:21]
+    res |= (imm >> 20 & 1)               << 31; // inst[31]
+    return res;
+}
+
+// Jumps to itself, marking the end of a generated program
+const u32 HALT = encode_j(Opcodes::OPCODE_JAL, 0, 0);
+
+struct GeneratorConfig
+{
+    // Relative weights of each instruction class. Branches are off by
+    // default as the executor doesn't implement them yet.
+    u32 weight_lui    = 1;
+    u32 weight_auipc  = 1;
+    u32 weight_op_imm = 6;
+    u32 weight_op_reg = 6;
+    u32 weight_jal    = 1;
+    u32 weight_jalr   = 1;
+    u32 weight_branch = 0;
+
+    // Chance of a source register being one written by one of the last
+    // few instructions, rather than any register
+    f64 dependency = 0.5;
+    usize dependency_window = 2;
+
+    // Number of instructions, including the final halt
+    usize length = 256;
+    // Furthest a jump or branch may skip forward, in instructions
+    usize max_skip = 8;
+    // Where the program will be loaded
+    u32 base = 0;
+};
+
+// Produces random but valid RV32E programs. Jumps and branches only go
+// forwards and stay inside the program, so every program ends up at the
+// halt instruction at its end.
+class ProgramGenerator
+{
+    enum Class {
+        CLASS_LUI,
+        CLASS_AUIPC,
+        CLASS_OP_IMM,
+        CLASS_OP_REG,
+        CLASS_JAL,
+        CLASS_JALR,
+        CLASS_BRANCH
+    };
+
+    GeneratorConfig config;
+    std::mt19937 prng;
+    std::discrete_distribution<u32> classes;
+    std::deque<u32> recent;
+
+public:
+    ProgramGenerator(GeneratorConfig c, u32 seed)
+    : config(c)
+    , prng(seed)
+    , classes({
+        static_cast<f64>(c.weight_lui),
+        static_cast<f64>(c.weight_auipc),
+        static_cast<f64>(c.weight_op_imm),
+        static_cast<f64>(c.weight_op_reg),
+        static_cast<f64>(c.weight_jal),
+        static_cast<f64>(c.weight_jalr),
+        static_cast<f64>(c.weight_branch)
+    })
+    {}
+
+    std::vector<u32> generate()
+    {
+        std::vector<u32> program;
+        program.reserve(config.length);
+        recent.clear();
+        for (usize i = 0; i + 1 < config.length; ++i) {
+            program.push_back(instruction(i));
+        }
+        program.push_back(HALT);
+        return program;
+    }
+
+private:
+    u32 random(u32 from, u32 to)
+    {
+        return std::uniform_int_distribution<u32>(from, to)(prng);
+    }
+
+    bool chance(f64 p)
+    {
+        return std::bernoulli_distribution(p)(prng);
+    }
+
+    u32 destination()
+    {
+        u32 rd = random(1, 15);
+        recent.push_front(rd);
+        if (recent.size() > config.dependency_window) {
+            recent.pop_back();
+        }
+        return rd;
+    }
+
+    u32 source()
+    {
+        if (!recent.empty() && chance(config.dependency)) {
+            return recent[random(0, recent.size() - 1)];
+        }
+        return random(0, 15);
+    }
+
+    // Offset in bytes from instruction i to a later one in the program
+    s32 forward_offset(usize i)
+    {
+        usize last = config.length - 1;
+        usize target = std::min(i + random(1, config.max_skip), last);
+        return (target - i) * 4;
+    }
+
+    u32 instruction(usize i)
+    {
+        switch (classes(prng)) {
+        case CLASS_LUI:
+            return upper(Opcodes::OPCODE_LUI);
+        case CLASS_AUIPC:
+            return upper(Opcodes::OPCODE_AUIPC);
+        case CLASS_OP_IMM:
+            return op_imm();
+        case CLASS_OP_REG:
+            return op_reg();
+        case CLASS_JAL:
+            return jal(i);
+        case CLASS_JALR: {
+            // Use x0 as the base so the target is known up front
+            u32 target = config.base + i * 4 + forward_offset(i);
+            if (target > binary_ones(11)) {
+                return jal(i);
+            }
+            return encode_i(Opcodes::OPCODE_JALR, destination(), 0, 0, target);
+        }
+        case CLASS_BRANCH: {
+            constexpr u32 funct3s[] = {
+                BranchF3::BRANCH_EQ,
+                BranchF3::BRANCH_NOT_EQ,
+                BranchF3::BRANCH_LESS_THAN_SIGNED,
+                BranchF3::BRANCH_GREATER_OR_EQ_SIGNED,
+                BranchF3::BRANCH_LESS_THAN_UNSIGNED,
+                BranchF3::BRANCH_GREATER_OR_EQ_UNSIGNED
+            };
+            u32 funct3 = funct3s[random(0, std::size(funct3s) - 1)];
+            u32 rs1 = source();
+            u32 rs2 = source();
+            s32 offset = forward_offset(i);
+            return encode_b(Opcodes::OPCODE_SOME_BRANCH, funct3, rs1, rs2, offset);
+        }
+        default:
+            return HALT;
+        }
+    }
+
+    // Arguments are drawn one at a time so a seed always gives the same
+    // program, whatever order the compiler evaluates them in
+    u32 upper(u32 opcode)
+    {
+        u32 rd = destination();
+        return encode_u(opcode, rd, random(0, binary_ones(20)));
+    }
+
+    u32 jal(usize i)
+    {
+        s32 offset = forward_offset(i);
+        return encode_j(Opcodes::OPCODE_JAL, destination(), offset);
+    }
+
+    u32 op_imm()
+    {
+        u32 funct3 = random(0, 7);
+        u32 rs1 = source();
+        u32 rd = destination();
+        if (funct3 == OpImmF3::OP_IMM_SLLI) {
+            u32 shamt = random(0, 31);
+            return encode_r(Opcodes::OPCODE_SOME_OP_IMM, rd, funct3, rs1, shamt, 0);
+        }
+        if (funct3 == OpImmF3::OP_IMM_SOME_SHIFT_R) {
+            u32 shamt = random(0, 31);
+            u32 funct7 = chance(0.5) ? RShiftF7::SHIFT_R_LOGIC : RShiftF7::SHIFT_R_ARITH;
+            return encode_r(Opcodes::OPCODE_SOME_OP_IMM, rd, funct3, rs1, shamt, funct7);
+        }
+        s32 imm = static_cast<s32>(random(0, binary_ones(12))) - (1 << 11);
+        return encode_i(Opcodes::OPCODE_SOME_OP_IMM, rd, funct3, rs1, imm);
+    }
+
+    u32 op_reg()
+    {
+        u32 funct3 = random(0, 7);
+        u32 funct7 = 0;
+        if (funct3 == OpRegF3::OP_REG_SOME_ARITH) {
+            funct7 = chance(0.5) ? ArithF7::ARITH_REG_ADD : ArithF7::ARITH_REG_SUB;
+        } else if (funct3 == OpRegF3::OP_REG_SOME_SHIFT_R) {
+            funct7 = chance(0.5) ? RShiftF7::SHIFT_R_LOGIC : RShiftF7::SHIFT_R_ARITH;
+        }
+        u32 rs1 = source();
+        u32 rs2 = source();
+        u32 rd = destination();
+        return encode_r(Opcodes::OPCODE_SOME_OP_REG, rd, funct3, rs1, rs2, funct7);
+    }
+};
+
+// Instruction level model of what a program should do, to check the
+// design's results against
+class ReferenceModel
+{
+    std::span<const u32> program;
+    u32 base;
+    u32 pc;
+    std::array<u32, 16> x = {};
+
+public:
+    ReferenceModel(std::span<const u32> p, u32 b = 0)
+    : program(p)
+    , base(b)
+    , pc(b)
+    {}
+
+    u32 read_register(usize i) const
+    {
+        return x[i];
+    }
+
+    u32 program_counter() const
+    {
+        return pc;
+    }
+
+    // Run up to the halt instruction, returning the number of
+    // instructions retired, or nothing if it doesn't halt in time
+    std::optional<usize> run(usize limit)
+    {
+        for (usize retired = 0; retired < limit; ++retired) {
+            usize index = (pc - base) / 4;
+            if (index >= program.size() || program[index] == HALT) {
+                return retired;
+            }
+            step(program[index]);
+        }
+        return std::nullopt;
+    }
+
+private:
+    void set(u32 rd, u32 value)
+    {
+        if (rd != 0) {
+            x[rd] = value;
+        }
+    }
+
+    void step(u32 inst)
+    {
+        u32 opcode = inst & binary_ones(7);
+        u32 rd     = inst >> 7  & binary_ones(4);
+        u32 funct3 = inst >> 12 & binary_ones(3);
+        u32 rs1    = inst >> 15 & binary_ones(4);
+        u32 rs2    = inst >> 20 & binary_ones(4);
+        u32 funct7 = inst >> 25;
+
+        u32 imm_i = static_cast<s32>(inst) >> 20;
+        u32 imm_u = inst & ~binary_ones(12);
+        u32 imm_b
+            = (static_cast<s32>(inst) >> 31 << 12)
+            | (inst >> 7  & 1)              << 11
+            | (inst >> 25 & binary_ones(6)) << 5
+            | (inst >> 8  & binary_ones(4)) << 1;
+        u32 imm_j
+            = (static_cast<s32>(inst) >> 31 << 20)
+            | (inst >> 12 & binary_ones(8))  << 12
+            | (inst >> 20 & 1)               << 11
+            | (inst >> 21 & binary_ones(10)) << 1;
+
+        u32 next = pc + 4;
+        switch (opcode) {
+        case Opcodes::OPCODE_LUI:
+            set(rd, imm_u);
+            break;
+        case Opcodes::OPCODE_AUIPC:
+            set(rd, pc + imm_u);
+            break;
+        case Opcodes::OPCODE_JAL:
+            set(rd, pc + 4);
+            next = pc + imm_j;
+            break;
+        case Opcodes::OPCODE_JALR:
+            next = x[rs1] + imm_i;
+            set(rd, pc + 4);
+            break;
+        case Opcodes::OPCODE_SOME_OP_IMM:
+            set(rd, alu(funct3, funct7, x[rs1], imm_i, false));
+            break;
+        case Opcodes::OPCODE_SOME_OP_REG:
+            set(rd, alu(funct3, funct7, x[rs1], x[rs2], true));
+            break;
+        case Opcodes::OPCODE_SOME_BRANCH:
+            if (branch_taken(funct3, x[rs1], x[rs2])) {
+                next = pc + imm_b;
+            }
+            break;
+        default:
+            break;
+        }
+        pc = next;
+    }
+
+    static u32 alu(u32 funct3, u32 funct7, u32 a, u32 b, bool reg)
+    {
+        u32 shamt = b & binary_ones(5);
+        switch (funct3) {
+        case OpRegF3::OP_REG_SOME_ARITH:
+            return reg && funct7 == ArithF7::ARITH_REG_SUB ? a - b : a + b;
+        case OpRegF3::OP_REG_SLL:  return a << shamt;
+        case OpRegF3::OP_REG_SLT:  return static_cast<s32>(a) < static_cast<s32>(b);
+        case OpRegF3::OP_REG_SLTU: return a < b;
+        case OpRegF3::OP_REG_XOR:  return a ^ b;
+        case OpRegF3::OP_REG_OR:   return a | b;
+        case OpRegF3::OP_REG_AND:  return a & b;
+        case OpRegF3::OP_REG_SOME_SHIFT_R:
+            return funct7 == RShiftF7::SHIFT_R_ARITH
+                ? static_cast<s32>(a) >> shamt
+                : a >> shamt;
+        default:
+            return 0;
+        }
+    }
+
+    static bool branch_taken(u32 funct3, u32 a, u32 b)
+    {
+        switch (funct3) {
+        case BranchF3::BRANCH_EQ:                     return a == b;
+        case BranchF3::BRANCH_NOT_EQ:                 return a != b;
+        case BranchF3::BRANCH_LESS_THAN_SIGNED:       return static_cast<s32>(a) < static_cast<s32>(b);
+        case BranchF3::BRANCH_GREATER_OR_EQ_SIGNED:   return static_cast<s32>(a) >= static_cast<s32>(b);
+        case BranchF3::BRANCH_LESS_THAN_UNSIGNED:     return a < b;
+        case BranchF3::BRANCH_GREATER_OR_EQ_UNSIGNED: return a >= b;
+        default:                                      return false;
+        }
+    }
+};
+
+// Load a program straight into the design's memory
+template<typename D>
+bool load_program(D &sim, std::span<const u32> program, u32 base = 0)
+{
+    auto memory = sim.template device<0>().words(base, program.size());
+    if (memory.size() != program.size()) {
+        return false;
+    }
+    std::ranges::copy(program, memory.begin());
+    return true;
+}
+
+// Clock the design until hart 0 executes the halt instruction at the given
+// address twice in a row, so it is stuck jumping to itself and everything
+// before it has finished. Returns false if it doesn't get there in time.
+template<typename D>
+bool run_to_halt(D &sim, u32 halt, usize limit)
+{
+    usize passes = 0;
+    // Nothing executes in a skipped cycle, so one can't hide the halt
+    while (limit > 0) {
+        limit -= sim.step(limit);
+        auto pc = sim.read_execute_address();
+        if (!pc) {
+            continue;
+        }
+        passes = *pc == halt ? passes + 1 : 0;
+        if (passes == 2) {
+            return true;
+        }
+    }
+    return false;
+}
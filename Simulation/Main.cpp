@@ -1,7 +1,12 @@
 #include "Common.hpp"
 #include "Device.hpp"
 #include "Memory.hpp"
+#include "Uart.hpp"
+#include "Dma.hpp"
+#include "Model.hpp"
+#include "Disasm.hpp"
 #include "Design.hpp"
+#include "Profiler.hpp"
 
 #include <concepts>
 #include <fstream>
@@ -18,18 +23,24 @@ int main(int argc, const char **argv)
     auto sim = MainDesign(context);
     sim.set_logging(true);
 
+    std::string symbols = context->commandArgsPlusMatch("symbols=");
+    if (!symbols.empty()) {
+        sim.load_symbols(symbols.substr(symbols.find('=') + 1));
+    }
+
     std::println("Loading program: ");
     sim.write_words(0, prog);
     sim.reset();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-    sim.cycle();
-}
+    auto profiler = Profiler(sim, 0, prog.size() * 4);
+    sim.do_cycles(10);
 
+    for (usize h = 0; h < params::hart_count; ++h) {
+        std::println(
+            "Hart {} stalled on the bus for {} of {} cycles", 
+            h, 
+            sim.read_stall_cycles(h), 
+            sim.cycles()
+        );
+    }
+    profiler.report();
+}
@@ -1,11 +1,16 @@
 #include <vector>
 #include <print>
+#include <algorithm>
+#include <span>
 
 class MemDevice : public BusDeviceBase
 {
     u32 address_offset;
     // TODO: no more hacky division by 4 stuff
     std::vector<u32> memory;
+    usize latency = 0;
+    usize remaining = 0;
+    bool pending = false;
 
 public:
     MemDevice(AddressRange range) 
@@ -25,20 +30,58 @@ public:
         return memory[(addr - address_offset) / 4];
     }
 
+    // Direct access to the backing store, empty if the range isn't mapped
+    std::span<u32> words(u32 addr, usize count)
+    {
+        usize begin = (addr - address_offset) / 4;
+        if (addr < address_offset || begin + count > memory.size()) {
+            return {};
+        }
+        return std::span(memory).subspan(begin, count);
+    }
+
+    // Number of cycles each transfer is held not ready for before
+    // completing, to emulate slower memory devices
+    void set_latency(usize cycles)
+    {
+        latency = cycles;
+    }
+
     void evaluate(BusDeviceSignals bus) override
     {
-        if (bus.addr - address_offset >= memory.size() / 4) {
+        if (!bus.sel || bus.trans != 2) {
+            pending = false;
+            bus.us_ready = 1;
+            return;
+        }
+        if ((bus.addr - address_offset) / 4 >= memory.size()) {
+            return;
+        }
+        if (!pending) {
+            pending = true;
+            remaining = latency;
+        }
+        if (remaining > 0) {
+            --remaining;
+            bus.us_ready = 0;
             return;
         }
         bus.us_ready = 1;
-        // TODO: delay on transfer to emulate real memory devices
-        if (bus.sel && bus.trans == 2) {
-            if (bus.write) {
-                write(bus.addr, bus.write_data);
-            } else {
-                bus.read_data = read(bus.addr);
-            }
+        if (bus.write) {
+            write(bus.addr, bus.write_data);
+        } else {
+            bus.read_data = read(bus.addr);
         }
     }
+
+    usize stall_cycles() override
+    {
+        return pending ? remaining : 0;
+    }
+
+    void skip_cycles(usize count) override
+    {
+        remaining -= std::min(count, remaining);
+    }
 };
 
@@ -0,0 +1,22 @@
+// The verilated model, and the parameters and enums exported from it
+#include "verilated.h"
+#include "VTop__Dpi.h"
+#include "VTop.h"
+#include "VTop___024unit.h"
+#include "VTop_Top.h"
+
+namespace params
+{
+constexpr auto hart_count   = VTop___024unit::HART_COUNT;
+constexpr auto device_count = VTop___024unit::AHB_DEVICE_COUNT;
+constexpr auto address_map  = VTop___024unit::AHB_ADDR_MAP;
+}
+
+using Opcodes  = VTop___024unit::opcode_field;
+using OpImmF3  = VTop___024unit::funct3_op_imm;
+using OpRegF3  = VTop___024unit::funct3_op_reg;
+using RShiftF7 = VTop___024unit::funct7_r_shift_kind;
+using ArithF7  = VTop___024unit::funct7_reg_arith;
+using BranchF3 = VTop___024unit::funct3_branch;
+using LoadF3   = VTop___024unit::funct3_load;
+using StoreF3  = VTop___024unit::funct3_store;
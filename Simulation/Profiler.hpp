@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Cycles spent at one instruction address. Each cycle is put down to at
+// most one cause, a fetch waiting on the bus taking priority over a skid
+// buffer holding back a value.
+struct ProfileEntry
+{
+    u64 cycles = 0;
+    u64 retired = 0;
+    u64 fetch_stalls = 0;
+    u64 skid_stalls = 0;
+};
+
+// Host side profiler. A cycle counts against the instruction about to
+// execute, or against the address being fetched when nothing is ready to
+// execute. With a period above one only every n-th cycle is looked at and
+// scaled up to match, while skipped idle cycles are always counted.
+template<typename D>
+class Profiler
+{
+    D &sim;
+    u32 base;
+    usize period;
+    usize countdown;
+
+    // Indexed by hart, then by (pc - base) / 4
+    std::vector<std::vector<ProfileEntry>> entries;
+    // Addresses outside the profiled range
+    std::array<ProfileEntry, params::hart_count> outside = {};
+    std::array<u64, params::hart_count> last_stalls = {};
+
+public:
+    Profiler(D &s, u32 b, usize size, usize p = 1)
+    : sim(s)
+    , base(b)
+    , period(std::max<usize>(p, 1))
+    , countdown(period)
+    , entries(params::hart_count, std::vector<ProfileEntry>(size / 4))
+    {
+        for (usize h = 0; h < params::hart_count; ++h) {
+            last_stalls[h] = sim.read_stall_cycles(h);
+        }
+        sim.set_cycle_hook([this](usize count) { on_cycles(count); });
+    }
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    ~Profiler()
+    {
+        sim.set_cycle_hook(nullptr);
+    }
+
+    void clear()
+    {
+        for (auto &hart : entries) {
+            std::ranges::fill(hart, ProfileEntry {});
+        }
+        outside.fill(ProfileEntry {});
+    }
+
+    const ProfileEntry &at(u32 pc, usize hart = 0) const
+    {
+        u32 index = (pc - base) / 4;
+        if (pc < base || index >= entries[hart].size()) {
+            return outside[hart];
+        }
+        return entries[hart][index];
+    }
+
+    ProfileEntry total(usize hart = 0) const
+    {
+        auto sum = outside[hart];
+        for (auto &entry : entries[hart]) {
+            sum.cycles       += entry.cycles;
+            sum.retired      += entry.retired;
+            sum.fetch_stalls += entry.fetch_stalls;
+            sum.skid_stalls  += entry.skid_stalls;
+        }
+        return sum;
+    }
+
+    // Basic blocks ordered by the cycles spent in them, with a line for
+    // each instruction in the block
+    void report(usize hart = 0, usize max_blocks = 10, std::FILE *out = stdout)
+    {
+        auto sum = total(hart);
+        std::println(
+            out,
+            "Hart {}: {} cycles, {} retired, {} fetch wait, {} skid stall",
+            hart,
+            sum.cycles,
+            sum.retired,
+            sum.fetch_stalls,
+            sum.skid_stalls
+        );
+
+        struct Block
+        {
+            usize begin;
+            usize end;
+            ProfileEntry sum;
+        };
+        std::vector<Block> blocks;
+        auto &hart_entries = entries[hart];
+        auto starts = block_starts();
+        for (usize i = 0; i < hart_entries.size(); ++i) {
+            if (starts[i] || blocks.empty()) {
+                blocks.push_back(Block { i, i, {} });
+            }
+            auto &block = blocks.back();
+            block.end = i + 1;
+            block.sum.cycles       += hart_entries[i].cycles;
+            block.sum.retired      += hart_entries[i].retired;
+            block.sum.fetch_stalls += hart_entries[i].fetch_stalls;
+            block.sum.skid_stalls  += hart_entries[i].skid_stalls;
+        }
+        std::ranges::stable_sort(blocks, [](auto &a, auto &b) {
+            return a.sum.cycles > b.sum.cycles;
+        });
+
+        for (auto &block : blocks | std::views::take(max_blocks)) {
+            if (block.sum.cycles == 0) {
+                break;
+            }
+            std::println(
+                out,
+                "Block 0x{:08x}-0x{:08x}: {} cycles ({:.1f}%), {} retired, "
+                "{} fetch wait, {} skid stall",
+                address(block.begin),
+                address(block.end) - 4,
+                block.sum.cycles,
+                100.0 * block.sum.cycles / sum.cycles,
+                block.sum.retired,
+                block.sum.fetch_stalls,
+                block.sum.skid_stalls
+            );
+            for (usize i = block.begin; i < block.end; ++i) {
+                auto &entry = hart_entries[i];
+                std::println(
+                    out,
+                    "  0x{:08x} {:>10} {:>10} {:>10} {:>10}  {}",
+                    address(i),
+                    entry.cycles,
+                    entry.retired,
+                    entry.fetch_stalls,
+                    entry.skid_stalls,
+                    sim.disassemble(sim.read_word(address(i)), address(i))
+                );
+            }
+        }
+        if (outside[hart].cycles > 0) {
+            std::println(
+                out,
+                "Outside 0x{:08x}-0x{:08x}: {} cycles",
+                base,
+                address(hart_entries.size()),
+                outside[hart].cycles
+            );
+        }
+    }
+
+    // Folded stacks as taken by flamegraph.pl, nested as hart, basic
+    // block, instruction and stall cause
+    void write_folded(std::FILE *out)
+    {
+        auto starts = block_starts();
+        for (usize h = 0; h < params::hart_count; ++h) {
+            u32 block = base;
+            for (usize i = 0; i < entries[h].size(); ++i) {
+                if (starts[i]) {
+                    block = address(i);
+                }
+                auto &entry = entries[h][i];
+                if (entry.cycles == 0) {
+                    continue;
+                }
+                auto frame = std::format(
+                    "hart {};block 0x{:08x};0x{:08x} {}",
+                    h,
+                    block,
+                    address(i),
+                    sim.disassemble(sim.read_word(address(i)), address(i))
+                );
+                u64 busy = entry.cycles - entry.fetch_stalls - entry.skid_stalls;
+                if (busy > 0) {
+                    std::println(out, "{} {}", frame, busy);
+                }
+                if (entry.fetch_stalls > 0) {
+                    std::println(out, "{};fetch wait {}", frame, entry.fetch_stalls);
+                }
+                if (entry.skid_stalls > 0) {
+                    std::println(out, "{};skid stall {}", frame, entry.skid_stalls);
+                }
+            }
+            if (outside[h].cycles > 0) {
+                std::println(out, "hart {};outside {}", h, outside[h].cycles);
+            }
+        }
+    }
+
+private:
+    u32 address(usize index) const
+    {
+        return base + index * 4;
+    }
+
+    ProfileEntry &entry_at(u32 pc, usize hart)
+    {
+        return const_cast<ProfileEntry &>(std::as_const(*this).at(pc, hart));
+    }
+
+    void on_cycles(usize count)
+    {
+        // Skipped cycles are counted exactly, simulated ones are sampled
+        bool sampled = count > 1;
+        if (count == 1 && --countdown == 0) {
+            countdown = period;
+            sampled = true;
+        }
+        u64 weight = count > 1 ? count : period;
+
+        for (usize h = 0; h < params::hart_count; ++h) {
+            // Kept up to date every cycle, so a sample sees only its own
+            u64 stalls = sim.read_stall_cycles(h);
+            bool fetch_stalled = stalls != last_stalls[h];
+            last_stalls[h] = stalls;
+            if (!sampled) {
+                continue;
+            }
+
+            auto executing = sim.read_execute_address(h);
+            auto &e = entry_at(executing.value_or(sim.read_fetch_address(h)), h);
+            e.cycles += weight;
+            if (executing) {
+                e.retired += weight;
+            }
+            if (fetch_stalled) {
+                e.fetch_stalls += weight;
+            } else if (sim.read_skid_stalled(h)) {
+                e.skid_stalls += weight;
+            }
+        }
+    }
+
+    // Marks the first instruction of every basic block in the profiled
+    // range, going by the jumps and branches currently in memory
+    std::vector<bool> block_starts()
+    {
+        usize size = entries[0].size();
+        std::vector<bool> starts(size);
+        auto mark = [&](u32 pc) {
+            u32 index = (pc - base) / 4;
+            if (pc >= base && index < size) {
+                starts[index] = true;
+            }
+        };
+        for (usize i = 0; i < size; ++i) {
+            u32 pc = address(i);
+            u32 inst = sim.read_word(pc);
+            if (auto target = Disassembler::target_of(inst, pc)) {
+                mark(*target);
+                mark(pc + 4);
+            } else if ((inst & 0x7F) == Opcodes::OPCODE_JALR) {
+                mark(pc + 4);
+            }
+        }
+        return starts;
+    }
+};
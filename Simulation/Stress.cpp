@@ -0,0 +1,101 @@
+#include "Common.hpp"
+#include "Device.hpp"
+#include "Memory.hpp"
+#include "Uart.hpp"
+#include "Dma.hpp"
+#include "Model.hpp"
+#include "Disasm.hpp"
+#include "Design.hpp"
+#include "Generator.hpp"
+
+#include <limits>
+#include <string>
+
+// Value of a +name=value argument, or the fallback if it wasn't given
+u64 plus_arg(VerilatedContext &context, const std::string &name, u64 fallback)
+{
+    std::string arg = context.commandArgsPlusMatch((name + "=").c_str());
+    if (arg.empty()) {
+        return fallback;
+    }
+    return std::stoull(arg.substr(arg.find('=') + 1));
+}
+
+// Runs many random programs through the design, checking each one
+// against the reference model.
+//   +programs=N  number of programs to run
+//   +length=N    instructions per program
+//   +seed=N      32 bit seed of the first program, each after it adds one
+int main(int argc, const char **argv)
+{
+    auto context = std::make_shared<VerilatedContext>();
+    context->commandArgs(argc, argv);
+
+    u64 programs = plus_arg(*context, "programs", 1000);
+    u64 seed_arg = plus_arg(*context, "seed", std::random_device{}());
+    auto config = GeneratorConfig{};
+    config.length = plus_arg(*context, "length", config.length);
+
+    // Programs are generated from 32 bit seeds
+    if (seed_arg > std::numeric_limits<u32>::max()) {
+        std::println("+seed must fit in 32 bits");
+        return 1;
+    }
+    u32 first = seed_arg;
+
+    auto sim = MainDesign(context);
+    usize retired = 0;
+    usize failed = 0;
+
+    for (u64 i = 0; i < programs; ++i) {
+        u32 seed = first + i;
+        auto program = ProgramGenerator(config, seed).generate();
+        auto model = ReferenceModel(program, config.base);
+        auto expected = model.run(program.size());
+        if (!expected) {
+            std::println("Seed {}: reference model didn't halt", seed);
+            ++failed;
+            continue;
+        }
+        retired += *expected;
+
+        if (!load_program(sim, program, config.base)) {
+            std::println("Seed {}: program doesn't fit in memory", seed);
+            return 1;
+        }
+        sim.reset();
+        u32 halt = model.program_counter();
+        usize limit = program.size() * 32 * params::hart_count;
+        bool matched = run_to_halt(sim, halt, limit);
+        if (!matched) {
+            std::println("Seed {}: design didn't reach the halt at 0x{:x}", seed, halt);
+        }
+
+        // Still compared without the halt, to show how far it got
+        for (usize r = 1; r < 16; ++r) {
+            if (sim.read_register(r) != model.read_register(r)) {
+                std::println(
+                    "Seed {}: x{} expected {:#x} but got {:#x}",
+                    seed,
+                    r,
+                    model.read_register(r),
+                    sim.read_register(r)
+                );
+                matched = false;
+                break;
+            }
+        }
+        if (!matched) {
+            ++failed;
+        }
+    }
+
+    std::println(
+        "{} of {} programs matched, {} instructions retired over {} cycles",
+        programs - failed,
+        programs,
+        retired,
+        sim.cycles()
+    );
+    return failed != 0;
+}
@@ -1,13 +1,67 @@
 #include "Common.hpp"
 #include "Device.hpp"
 #include "Memory.hpp"
+#include "Uart.hpp"
+#include "Dma.hpp"
+#include "Model.hpp"
+#include "Disasm.hpp"
 #include "Design.hpp"
+#include "Coverage.hpp"
+#include "Generator.hpp"
+#include "Profiler.hpp"
 #include "Case.hpp"
 
 #include <tuple>
+#include <unistd.h>
 
 constexpr u32 NOP = Opcodes::OPCODE_SOME_OP_IMM | (OpImmF3::OP_IMM_ADDI);
 
+// Code/Jump.asm linked into an ELF file, from +symbols=<path>
+std::string jump_symbols;
+
+// Run until hart 0 has executed the given number of instructions, which
+// mustn't access the bus, however long other harts keep it from fetching
+bool run_instructions(MainDesign &sim, usize count, usize limit = 1000)
+{
+    usize executed = 0;
+    for (usize i = 0; i < limit; ++i) {
+        bool executing = sim.read_execute_address().has_value();
+        sim.cycle();
+        if (executing && ++executed == count) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Runs hart 0 through its next instructions, which mustn't access the bus.
+// A lone hart takes exactly two cycles for each, and two more to fetch the
+// first after a reset, and is held to that. Other harts hold its fetches
+// up, so with more than one it waits for them to execute instead.
+void execute(MainDesign &sim, TestContext &test, usize count, bool from_reset)
+{
+    if constexpr (params::hart_count == 1) {
+        sim.do_cycles(count * 2 + (from_reset ? 2 : 0));
+    } else {
+        test.test_assert(
+            run_instructions(sim, count), 
+            std::format("{} instructions never executed", count)
+        );
+    }
+}
+
+// Run until hart 0 starts fetching from the given address
+bool run_until_fetching(MainDesign &sim, u32 addr, usize limit = 1000)
+{
+    for (usize i = 0; i < limit; ++i) {
+        sim.cycle();
+        if (sim.read_fetch_address() == addr) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void test_fetch(MainDesign &sim, TestContext &test)
 {
     test.name("Instruction fetching");
@@ -30,10 +84,7 @@ void test_lui(MainDesign &sim, TestContext &test)
     auto inst = value | (dest << 7) | Opcodes::OPCODE_LUI;
     sim.write_word(0, inst);
     sim.reset();
-    sim.cycle(); // begin transfer
-    sim.cycle(); // Should have a reply
-    sim.cycle(); // Begin decode
-    sim.cycle(); // execute
+    execute(sim, test, 1, true);
     test.test_assert_eq(value, sim.read_register(dest));
 }
 
@@ -54,8 +105,7 @@ void test_auipc(MainDesign &sim, TestContext &test)
     sim.write_word(inst_loc, inst);
 
     sim.reset();
-    sim.do_cycles(2 + noop_count * 2);
-    sim.do_cycles(2);
+    execute(sim, test, noop_count + 1, true);
     test.test_assert_eq(inst_loc + value, sim.read_register(dest));
 }
 
@@ -83,10 +133,17 @@ void test_jal(MainDesign &sim, TestContext &test)
     sim.write_word(inst_loc, inst);
 
     sim.reset();
-    sim.do_cycles(2 + noop_count * 2);
-    sim.do_cycles(4);
+    execute(sim, test, noop_count + 1, true);
 
-    test.test_assert_eq(inst_loc + jump_offset, sim.read_program_counter());
+    if constexpr (params::hart_count == 1) {
+        sim.do_cycles(2);
+        test.test_assert_eq(inst_loc + jump_offset, sim.read_program_counter());
+    } else {
+        test.test_assert(
+            run_until_fetching(sim, inst_loc + jump_offset), 
+            "never fetched from the jump target"
+        );
+    }
     test.test_assert_eq(inst_loc + 4, sim.read_register(dest));
 }
 
@@ -117,10 +174,17 @@ void test_jalr(MainDesign &sim, TestContext &test)
     sim.reset();
     sim.write_register(src, target);
 
-    sim.do_cycles(2 + noop_count * 2);
-    sim.do_cycles(4);
+    execute(sim, test, noop_count + 1, true);
 
-    test.test_assert_eq(sim.read_program_counter(), target + jump_offset);
+    if constexpr (params::hart_count == 1) {
+        sim.do_cycles(2);
+        test.test_assert_eq(sim.read_program_counter(), target + jump_offset);
+    } else {
+        test.test_assert(
+            run_until_fetching(sim, target + jump_offset), 
+            "never fetched from the jump target"
+        );
+    }
     test.test_assert_eq(sim.read_register(dest), inst_loc + 4);
 }
 
@@ -164,11 +228,9 @@ void test_op_imm(MainDesign &sim, TestContext &test)
     sim.write_word(16, inst(OpImmF3::OP_IMM_ANDI));
     sim.write_word(20, inst(OpImmF3::OP_IMM_SLTI));
 
-    sim.do_cycles(2);
-
     for (auto [i, elem] : std::views::enumerate(results)) {
         auto [name, result] = elem;
-        sim.do_cycles(2);
+        execute(sim, test, 1, i == 0);
         test.test_assert_eq(sim.read_register(dest), result);
     }
 }
@@ -206,11 +268,9 @@ void test_op_imm_shift(MainDesign &sim, TestContext &test)
     sim.write_word(4,  inst(OpImmF3::OP_IMM_SOME_SHIFT_R, RShiftF7::SHIFT_R_LOGIC));
     sim.write_word(8,  inst(OpImmF3::OP_IMM_SOME_SHIFT_R, RShiftF7::SHIFT_R_ARITH));
 
-    sim.do_cycles(2);
-
     for (auto [i, elem] : std::views::enumerate(results)) {
         auto [name, result] = elem;
-        sim.do_cycles(2);
+        execute(sim, test, 1, i == 0);
         test.test_assert_eq(sim.read_register(dest), result);
     }
 }
@@ -255,11 +315,9 @@ void test_op_reg(MainDesign &sim, TestContext &test)
     sim.write_word(20, inst(OpRegF3::OP_REG_SLTU, 0));
     sim.write_word(24, inst(OpRegF3::OP_REG_SLT, 0));
 
-    sim.do_cycles(2);
-
     for (auto [i, elem] : std::views::enumerate(results)) {
         auto [name, result] = elem;
-        sim.do_cycles(2);
+        execute(sim, test, 1, i == 0);
         test.test_assert_eq(sim.read_register(dest), result);
     }
 }
@@ -296,21 +354,506 @@ void test_op_reg_shift(MainDesign &sim, TestContext &test)
     sim.write_word(4,  inst(OpRegF3::OP_REG_SOME_SHIFT_R, RShiftF7::SHIFT_R_LOGIC));
     sim.write_word(8,  inst(OpRegF3::OP_REG_SOME_SHIFT_R, RShiftF7::SHIFT_R_ARITH));
 
-    sim.do_cycles(2);
-
     for (auto [i, elem] : std::views::enumerate(results)) {
         auto [name, result] = elem;
-        sim.do_cycles(2);
+        execute(sim, test, 1, i == 0);
         test.test_assert_eq(sim.read_register(dest), result);
     }
 }
 
+void test_random_program(MainDesign &sim, TestContext &test)
+{
+    test.name("Random program");
+
+    auto config = GeneratorConfig{};
+    config.length = 64;
+    u32 seed = test.random_u32();
+    auto program = ProgramGenerator(config, seed).generate();
+    auto model = ReferenceModel(program, config.base);
+
+    test.test_assert(model.run(program.size()).has_value(), "model didn't halt");
+    test.test_assert(load_program(sim, program, config.base), "program too big");
+    sim.reset();
+    test.test_assert(
+        run_to_halt(
+            sim, 
+            model.program_counter(), 
+            program.size() * 32 * params::hart_count
+        ),
+        std::format("seed {} didn't halt", seed)
+    );
+
+    for (usize i = 1; i < 16; ++i) {
+        test.test_assert_eq(
+            model.read_register(i),
+            sim.read_register(i),
+            std::format("seed {}, x{}", seed, i)
+        );
+    }
+}
+
+void test_fast_forward(MainDesign &sim, TestContext &test)
+{
+    test.name("Idle cycle skipping");
+
+    auto ctx = std::make_shared<VerilatedContext>();
+    auto slow = MainDesign(ctx);
+
+    auto value = test.random(0, 4096) << 12;
+    auto dest = test.random_reg();
+    auto inst = value | (dest << 7) | Opcodes::OPCODE_LUI;
+    auto latency = test.random(1, 64);
+    u32 noop_count = test.random(0, 8);
+
+    for (auto *design : { &sim, &slow }) {
+        for (int i = 0; i < noop_count; ++i) {
+            design->write_word(i * 4, NOP);
+        }
+        design->write_word(noop_count * 4, inst);
+        design->device<0>().set_latency(latency);
+        design->reset();
+    }
+    slow.set_fast_forward(false);
+
+    // Each fetch is held for the memory latency on top of the usual cycles,
+    // with some slack at the end for the pipeline to drain. Other harts 
+    // can hold each fetch up by as long again.
+    usize cycles = ((noop_count + 1) * (latency + 2) + 4) * params::hart_count;
+    sim.do_cycles(cycles);
+    slow.do_cycles(cycles);
+
+    test.test_assert_eq(slow.cycles(), sim.cycles(), "cycle count differs");
+    test.test_assert_eq(0lu, slow.skipped_cycles(), "skipped while turned off");
+    // The first two cycles of a fetch can't be skipped, as the fetch unit
+    // is still settling into waiting. With other harts queued up behind
+    // it for the bus the core is never quiescent.
+    if (params::hart_count == 1 && latency > 2) {
+        test.test_assert(sim.skipped_cycles() > 0, "no cycles were skipped");
+    }
+    test.test_assert_eq(
+        slow.read_stall_cycles(), 
+        sim.read_stall_cycles(),
+        "stall count differs"
+    );
+    test.test_assert_eq(
+        slow.read_program_counter(), 
+        sim.read_program_counter(),
+        "program counter differs"
+    );
+    test.test_assert_eq(value, slow.read_register(dest));
+    test.test_assert_eq(value, sim.read_register(dest));
+}
+
+void test_harts(MainDesign &sim, TestContext &test)
+{
+    test.name("Per hart state");
+
+    constexpr u32 id = MainDesign::hart_id_register;
+    auto value = test.random(0, 4096) << 12;
+    auto dest = test.random_reg_exclude(id);
+    auto reg = test.random_reg_exclude(dest, id);
+    auto id_dest = test.random_reg_exclude(dest, reg, id);
+    s32 offset = test.random(0, 1024);
+
+    // Every hart runs the same program, but works out its own result
+    sim.write_word(0, value | (dest << 7) | Opcodes::OPCODE_LUI);
+    sim.write_word(4, encode_i(
+        Opcodes::OPCODE_SOME_OP_IMM, id_dest, OpImmF3::OP_IMM_ADDI, id, offset
+    ));
+    sim.write_word(8, HALT);
+    sim.reset();
+
+    std::vector<u32> written;
+    for (usize h = 0; h < params::hart_count; ++h) {
+        written.push_back(test.random_u32());
+        sim.write_register(reg, written[h], h);
+    }
+
+    // Each hart contends with the others for the bus on every fetch
+    sim.do_cycles(16 * params::hart_count + 16);
+
+    for (usize h = 0; h < params::hart_count; ++h) {
+        auto info = std::format("hart {}", h);
+        test.test_assert_eq(written[h], sim.read_register(reg, h), info);
+        test.test_assert_eq(value, sim.read_register(dest, h), info);
+        test.test_assert_eq(h, sim.read_register(id, h), info);
+        test.test_assert_eq(h + offset, sim.read_register(id_dest, h), info);
+    }
+}
+
+void test_console(MainDesign &sim, TestContext &test)
+{
+    test.name("Console device");
+
+    // Host side only, test_dma_console covers transfers over the bus
+
+    constexpr u32 data   = params::address_map[1];
+    constexpr u32 status = params::address_map[1] + 4;
+
+    auto &console = sim.device<1>();
+    std::FILE *out = std::tmpfile();
+    std::FILE *in  = std::tmpfile();
+    console.set_output(out);
+
+    std::string line = "Hello, world!";
+    std::fputs(line.c_str(), in);
+    std::rewind(in);
+    console.set_input(in);
+
+    for (char c : line) {
+        sim.write_word(data, c);
+    }
+    test.test_assert_eq(0l, std::ftell(out), "output was not buffered");
+    sim.write_word(data, '\n');
+
+    std::string written(line.size() + 1, 0);
+    std::rewind(out);
+    std::fread(written.data(), 1, written.size(), out);
+    test.test_assert_eq(line + "\n", written, "output was not flushed");
+
+    std::string received;
+    while (sim.read_word(status) & 1) {
+        received.push_back(sim.read_word(data));
+    }
+    test.test_assert_eq(line, received);
+
+    console.set_output(stdout);
+    console.set_input(nullptr);
+    std::fclose(out);
+    std::fclose(in);
+}
+
+void test_dma(MainDesign &sim, TestContext &test, bool timing_accurate)
+{
+    constexpr u32 dma         = params::address_map[2];
+    constexpr u32 source      = dma + 0x00;
+    constexpr u32 destination = dma + 0x04;
+    constexpr u32 length      = dma + 0x08;
+    constexpr u32 control     = dma + 0x0C;
+    constexpr u32 status      = dma + 0x10;
+
+    u32 words = test.random(1, 16);
+    u32 from = 0x400;
+    u32 to = 0x600;
+    std::vector<u32> data;
+    for (u32 i = 0; i < words; ++i) {
+        data.push_back(test.random_u32());
+    }
+
+    sim.device<2>().set_timing_accurate(timing_accurate);
+    sim.write_words(from, data);
+    sim.reset();
+
+    sim.write_word(source, from);
+    sim.write_word(destination, to);
+    sim.write_word(length, words * 4);
+    sim.write_word(control, 1);
+
+    usize limit = 1000;
+    while (!(sim.read_word(status) & 2) && limit--) {
+        sim.cycle();
+    }
+    test.test_assert(sim.read_word(status) & 2, "copy never finished");
+
+    for (u32 i = 0; i < words; ++i) {
+        test.test_assert_eq(data[i], sim.read_word(to + i * 4));
+    }
+
+    // One cycle for the device to raise the acknowledgement, one for the
+    // DMA unit to see it
+    sim.write_word(status, 0);
+    sim.do_cycles(2);
+    test.test_assert_eq(0u, sim.read_word(status), "completion not acknowledged");
+}
+
+void test_dma_host(MainDesign &sim, TestContext &test)
+{
+    test.name("DMA host side copy");
+    test_dma(sim, test, false);
+}
+
+void test_dma_bus(MainDesign &sim, TestContext &test)
+{
+    test.name("DMA copy over the bus");
+    test_dma(sim, test, true);
+}
+
+// Copies between memory and the console, so the bus has to switch devices
+// between the DMA unit's read and its write
+void test_dma_console(MainDesign &sim, TestContext &test)
+{
+    test.name("DMA copy to and from the console");
+
+    constexpr u32 dma            = params::address_map[2];
+    constexpr u32 console_data   = params::address_map[1];
+    constexpr u32 console_status = params::address_map[1] + 4;
+
+    auto copy_word = [&](u32 from, u32 to) {
+        sim.write_word(dma + 0x00, from);
+        sim.write_word(dma + 0x04, to);
+        sim.write_word(dma + 0x08, 4);
+        sim.write_word(dma + 0x0C, 1);
+        usize limit = 1000;
+        while (!(sim.read_word(dma + 0x10) & 2) && limit--) {
+            sim.cycle();
+        }
+        test.test_assert(sim.read_word(dma + 0x10) & 2, "copy never finished");
+        sim.write_word(dma + 0x10, 0);
+        sim.do_cycles(2);
+    };
+
+    auto &console = sim.device<1>();
+    std::FILE *out = std::tmpfile();
+    console.set_output(out);
+    sim.device<2>().set_timing_accurate(true);
+    sim.reset();
+
+    // Each copy only puts the low byte of one word out
+    std::string line = "DMA\n";
+    for (char c : line) {
+        sim.write_word(0x400, (test.random_u32() & ~0xFFu) | u8(c));
+        copy_word(0x400, console_data);
+    }
+    std::string written(line.size(), 0);
+    std::rewind(out);
+    std::fread(written.data(), 1, written.size(), out);
+    test.test_assert_eq(line, written, "console did not receive the copy");
+
+    // With no input the console can only transmit
+    sim.write_word(0x600, test.random_u32());
+    copy_word(console_status, 0x600);
+    test.test_assert_eq(2u, sim.read_word(0x600), "status was not copied");
+
+    console.set_output(stdout);
+    std::fclose(out);
+}
+
+void test_profiler(MainDesign &sim, TestContext &test)
+{
+    test.name("Profiler");
+
+    u32 noop_count = test.random(1, 8);
+    for (u32 i = 0; i < noop_count; ++i) {
+        sim.write_word(i * 4, NOP);
+    }
+    sim.write_word(noop_count * 4, HALT);
+    auto latency = test.random(0, 16);
+    sim.device<0>().set_latency(latency);
+    u32 size = (noop_count + 1) * 4;
+    // Enough for every NOP to go through, as in test_fast_forward
+    usize cycles 
+        = ((noop_count + 1) * (latency + 2) + 4) * params::hart_count;
+
+    // Every cycle is counted once, and each instruction before the halt
+    // goes through exactly once
+    sim.reset();
+    {
+        auto start = sim.cycles();
+        auto stalls = sim.read_stall_cycles();
+        auto profiler = Profiler(sim, 0, size);
+        sim.do_cycles(cycles);
+        auto total = profiler.total();
+        test.test_assert_eq(sim.cycles() - start, total.cycles, "exact cycles");
+        test.test_assert_eq(
+            sim.read_stall_cycles() - stalls, total.fetch_stalls, "fetch stalls"
+        );
+        for (u32 i = 0; i < noop_count; ++i) {
+            test.test_assert_eq(u64 { 1 }, profiler.at(i * 4).retired, "retired");
+        }
+    }
+
+    // Sampling drops at most a period's worth of simulated cycles
+    sim.reset();
+    {
+        usize period = test.random(2, 16);
+        auto start = sim.cycles();
+        auto profiler = Profiler(sim, 0, size, period);
+        sim.do_cycles(cycles);
+        auto counted = profiler.total().cycles;
+        auto elapsed = sim.cycles() - start;
+        test.test_assert(counted <= elapsed, "sampled too many cycles");
+        test.test_assert(counted + period > elapsed, "sampled too few cycles");
+    }
+}
+
+void test_disassembler(MainDesign &sim, TestContext &test)
+{
+    test.name("Native disassembler");
+
+    auto disassemble = Disassembler();
+    auto rd = test.random_reg();
+    auto rs1 = test.random_reg();
+    auto rs2 = test.random_reg();
+    s32 imm = static_cast<s32>(test.random(0, 4095)) - 2048;
+
+    test.test_assert_eq(
+        std::format("addi x{}, x{}, {}", rd, rs1, imm),
+        disassemble(encode_i(
+            Opcodes::OPCODE_SOME_OP_IMM, rd, OpImmF3::OP_IMM_ADDI, rs1, imm
+        ))
+    );
+    test.test_assert_eq(
+        std::format("lw x{}, {}(x{})", rd, imm, rs1),
+        disassemble(encode_i(
+            Opcodes::OPCODE_SOME_LOAD, rd, LoadF3::LOAD_WORD, rs1, imm
+        ))
+    );
+    test.test_assert_eq(
+        std::format("sub x{}, x{}, x{}", rd, rs1, rs2),
+        disassemble(encode_r(
+            Opcodes::OPCODE_SOME_OP_REG, 
+            rd, 
+            OpRegF3::OP_REG_SOME_ARITH, 
+            rs1, 
+            rs2, 
+            ArithF7::ARITH_REG_SUB
+        ))
+    );
+    test.test_assert_eq(
+        std::format("bne x{}, x{}, {}", rs1, rs2, imm & ~1),
+        disassemble(encode_b(
+            Opcodes::OPCODE_SOME_BRANCH, BranchF3::BRANCH_NOT_EQ, rs1, rs2, imm
+        ))
+    );
+
+    // Formatted once, then served from the cache
+    auto &first = disassemble(HALT);
+    auto &second = disassemble(HALT);
+    test.test_assert(&first == &second, "instruction not cached");
+
+    // Targets are named after the closest symbol below them
+    disassemble.add_symbol(0x100, "loop");
+    test.test_assert_eq(
+        std::string("jal x0, -8 <loop>"),
+        disassemble(encode_j(Opcodes::OPCODE_JAL, 0, -8), 0x108)
+    );
+    test.test_assert_eq(
+        std::string("jal x0, 4 <loop+0x4>"),
+        disassemble(encode_j(Opcodes::OPCODE_JAL, 0, 4), 0x100)
+    );
+    test.test_assert_eq(
+        std::string("jal x0, 4"),
+        disassemble(encode_j(Opcodes::OPCODE_JAL, 0, 4), 0x0)
+    );
+}
+
+void test_symbols(MainDesign &sim, TestContext &test)
+{
+    test.name("Symbols from an ELF file");
+
+    test.test_assert(
+        !jump_symbols.empty(), 
+        "no ELF file for Code/Jump.asm given with +symbols="
+    );
+    test.test_assert(
+        sim.load_symbols(jump_symbols), 
+        std::format("couldn't load {}", jump_symbols)
+    );
+
+    test.test_assert_eq(
+        std::string("jal x1, 16 <sub1>"),
+        sim.disassemble(encode_j(Opcodes::OPCODE_JAL, 1, 16), 0x0)
+    );
+    test.test_assert_eq(
+        std::string("jal x1, 28 <sub2>"),
+        sim.disassemble(encode_j(Opcodes::OPCODE_JAL, 1, 28), 0x4)
+    );
+    test.test_assert_eq(
+        std::string("jal x0, 8 <sub1+0x4>"),
+        sim.disassemble(encode_j(Opcodes::OPCODE_JAL, 0, 8), 0xC)
+    );
+}
+
+void test_coverage(MainDesign &, TestContext &test)
+{
+    test.name("Functional coverage");
+
+    using Coverage = FunctionalCoverage;
+    auto has = [](const std::vector<Coverage::Bin> &bins, Coverage::Bin bin) {
+        return std::ranges::any_of(bins, [&](auto &b) {
+            return b.opcode == bin.opcode 
+                && b.funct3 == bin.funct3 
+                && b.hazard == bin.hazard;
+        });
+    };
+
+    auto rd = test.random_reg_exclude(0u);
+    auto rs = test.random_reg_exclude(0u, rd);
+    auto both = Coverage::Bin { 
+        Opcodes::OPCODE_SOME_OP_REG, 0, Coverage::HAZARD_BOTH 
+    };
+    auto rs1 = Coverage::Bin { 
+        Opcodes::OPCODE_SOME_OP_REG, 0, Coverage::HAZARD_RS1 
+    };
+    auto branch = Coverage::Bin { 
+        Opcodes::OPCODE_SOME_BRANCH, 0, Coverage::HAZARD_NONE 
+    };
+
+    auto coverage = Coverage();
+    test.test_assert(has(coverage.uncovered(), both), "bin covered too early");
+    test.test_assert(!has(coverage.uncovered(), branch), "branches not excluded");
+
+    // add rd, rd, rd straight after writing rd hits both sources
+    auto addi = encode_i(Opcodes::OPCODE_SOME_OP_IMM, rd, 0, 0, 1);
+    auto add  = encode_r(Opcodes::OPCODE_SOME_OP_REG, rd, 0, rd, rd, 0);
+    coverage.record(0, addi);
+    coverage.record(0, add);
+    auto uncovered = coverage.uncovered();
+    test.test_assert(!has(uncovered, both), "hazard on both sources missed");
+    test.test_assert(has(uncovered, rs1), "wrong hazard bin");
+
+    // Reading rd again doesn't count once the history is cleared
+    coverage.clear_history();
+    coverage.record(0, encode_r(Opcodes::OPCODE_SOME_OP_REG, rs, 0, rd, rs, 0));
+    test.test_assert(has(coverage.uncovered(), rs1), "history not cleared");
+
+    char path[] = "/tmp/coverage_XXXXXX";
+    int fd = mkstemp(path);
+    test.test_assert(fd >= 0, "couldn't make a temporary file");
+    close(fd);
+    test.test_assert(coverage.write(path), "couldn't write coverage");
+
+    auto merged = Coverage();
+    test.test_assert(merged.merge(path), "couldn't merge coverage");
+    test.test_assert_eq(
+        coverage.uncovered().size(), 
+        merged.uncovered().size(), 
+        "merged coverage differs"
+    );
+    test.test_assert(!has(merged.uncovered(), both), "merged bin lost");
+    unlink(path);
+}
+
+// With +coverage_dir=<dir>, write this run's coverage into the directory 
+// under a unique name so that parallel runs can be merged afterwards
+void write_coverage(VerilatedContext &context, FunctionalCoverage &coverage)
+{
+    std::string arg = context.commandArgsPlusMatch("coverage_dir=");
+    if (arg.empty()) {
+        return;
+    }
+    auto dir = arg.substr(arg.find('=') + 1);
+    auto path = std::format("{}/run_{}", dir, getpid());
+#if VM_COVERAGE
+    context.coveragep()->write((path + ".dat").c_str());
+#endif
+    coverage.write(path + ".cov");
+}
+
 int main(int argc, const char **argv)
 {
     auto context = std::make_shared<VerilatedContext>();
     context->commandArgs(argc, argv);
+    auto coverage = FunctionalCoverage();
+
+    std::string symbols = context->commandArgsPlusMatch("symbols=");
+    if (!symbols.empty()) {
+        jump_symbols = symbols.substr(symbols.find('=') + 1);
+    }
+
     run_tests(
         context,
+        coverage,
         test_fetch, 
         test_lui,
         test_auipc,
@@ -319,7 +862,19 @@ int main(int argc, const char **argv)
         test_op_imm,
         test_op_imm_shift,
         test_op_reg,
-        test_op_reg_shift
+        test_op_reg_shift,
+        test_random_program,
+        test_fast_forward,
+        test_harts,
+        test_console,
+        test_dma_host,
+        test_dma_bus,
+        test_dma_console,
+        test_profiler,
+        test_disassembler,
+        test_symbols,
+        test_coverage
     );
+    write_coverage(*context, coverage);
 }
 
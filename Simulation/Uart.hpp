@@ -0,0 +1,197 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <poll.h>
+#include <unistd.h>
+
+// Memory mapped serial console. Transmitted bytes are collected on the
+// host and only written out in batches, received bytes are read from the
+// input file in chunks.
+//
+// The core cannot load or store yet, so programs have no way to reach it.
+// For now it is driven by the host through read() and write(), and over
+// the bus by the DMA unit.
+//
+// Registers (word access only):
+//   +0x0 DATA   : write to transmit the low byte, read to receive a byte
+//   +0x4 STATUS : bit 0 set when a byte can be received,
+//                 bit 1 set when a byte can be transmitted
+class UartDevice : public BusDeviceBase
+{
+    static constexpr usize flush_threshold = 4096;
+    static constexpr usize read_chunk      = 4096;
+
+    static constexpr u32 reg_data   = 0x0;
+    static constexpr u32 reg_status = 0x4;
+
+    static constexpr u32 status_rx_ready = 1 << 0;
+    static constexpr u32 status_tx_ready = 1 << 1;
+
+    u32 address_offset;
+    bool pending = false;
+
+    std::FILE *output = stdout;
+    std::FILE *input = nullptr;
+    bool owns_output = false;
+    bool owns_input = false;
+
+    std::string tx;
+    std::vector<u8> rx;
+    usize rx_position = 0;
+
+public:
+    UartDevice(AddressRange range)
+    : address_offset(range.begin)
+    {
+        tx.reserve(flush_threshold);
+    }
+
+    UartDevice(const UartDevice &) = delete;
+    UartDevice &operator=(const UartDevice &) = delete;
+
+    ~UartDevice()
+    {
+        flush();
+        close_output();
+        close_input();
+    }
+
+    void set_output(std::FILE *file)
+    {
+        flush();
+        close_output();
+        output = file;
+    }
+
+    bool open_output(const char *path)
+    {
+        auto file = std::fopen(path, "w");
+        if (!file) {
+            return false;
+        }
+        set_output(file);
+        owns_output = true;
+        return true;
+    }
+
+    // Also works with a named pipe or the read end of popen()
+    void set_input(std::FILE *file)
+    {
+        close_input();
+        input = file;
+        rx.clear();
+        rx_position = 0;
+    }
+
+    bool open_input(const char *path)
+    {
+        auto file = std::fopen(path, "r");
+        if (!file) {
+            return false;
+        }
+        set_input(file);
+        owns_input = true;
+        return true;
+    }
+
+    void flush()
+    {
+        if (!tx.empty() && output) {
+            std::fwrite(tx.data(), 1, tx.size(), output);
+            std::fflush(output);
+        }
+        tx.clear();
+    }
+
+    void write(u32 addr, u32 value) override
+    {
+        if (addr - address_offset != reg_data) {
+            return;
+        }
+        char c = static_cast<char>(value & 0xFF);
+        tx.push_back(c);
+        if (c == '\n' || tx.size() >= flush_threshold) {
+            flush();
+        }
+    }
+
+    u32 read(u32 addr) override
+    {
+        switch (addr - address_offset) {
+        case reg_data:
+            return rx_available() ? rx[rx_position++] : 0;
+        case reg_status:
+            return status_tx_ready | (rx_available() ? status_rx_ready : 0);
+        default:
+            return 0;
+        }
+    }
+
+    void evaluate(BusDeviceSignals bus) override
+    {
+        bus.us_ready = 1;
+        bus.response = 0;
+        if (!bus.sel || bus.trans != 2) {
+            pending = false;
+            return;
+        }
+        // The transfer stays on the bus until the master sees it complete,
+        // so only act on it once
+        if (pending) {
+            return;
+        }
+        pending = true;
+        if (bus.write) {
+            write(bus.addr, bus.write_data);
+        } else {
+            bus.read_data = read(bus.addr);
+        }
+    }
+
+private:
+    bool rx_available()
+    {
+        if (rx_position < rx.size()) {
+            return true;
+        }
+        if (!input) {
+            return false;
+        }
+        // Only read when something is waiting, so that polling STATUS with
+        // an empty pipe, FIFO or terminal doesn't block the simulation
+        auto fd = fileno(input);
+        auto request = pollfd { fd, POLLIN, 0 };
+        if (::poll(&request, 1, 0) <= 0) {
+            return false;
+        }
+        // read() rather than fread() so a pipe hands back whatever it has
+        // instead of waiting until the whole chunk is filled
+        rx.resize(read_chunk);
+        auto got = ::read(fd, rx.data(), read_chunk);
+        rx.resize(got > 0 ? got : 0);
+        rx_position = 0;
+        // Errors such as EAGAIN mean no byte yet, only end of file closes
+        if (got == 0) {
+            close_input();
+        }
+        return !rx.empty();
+    }
+
+    void close_output()
+    {
+        if (owns_output) {
+            std::fclose(output);
+        }
+        output = stdout;
+        owns_output = false;
+    }
+
+    void close_input()
+    {
+        if (owns_input) {
+            std::fclose(input);
+        }
+        input = nullptr;
+        owns_input = false;
+    }
+};